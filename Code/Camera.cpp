@@ -3,7 +3,9 @@
 #include <limits>
 #include "vector.h" 
 #include "Ray.h"    
+#include "sampler.h"
 #include "Camera.h"
+#include "wavefront.h"
 #include <iostream>
 #include "color.h"
 #include "hittable.h"
@@ -11,9 +13,7 @@
 #include <thread>
 #include <stdio.h>
 #include <filesystem>
-#include <random>
 #include <fstream>
-#include "combine_ppms.h"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -21,38 +21,30 @@
 #include <unistd.h>
 #endif
 
-// Removes a file from the filesystem.
+// Generates a random vector with components in [min, max).
 /**
-* @param filePath The path to the file to remove.
-* @return True if the file was successfully removed, false otherwise.
-*/
-bool removeFile(const std::string& filePath) {
-   #ifdef _WIN32
-       return DeleteFileA(filePath.c_str()) != 0;
-   #else
-       return std::remove(filePath.c_str()) == 0;
-   #endif
-   }
-   
-// Generates a random double in the range [min, max].
-/**
- * @param min The minimum value.
- * @param max The maximum value.
- * @return A random double in the specified range.
+ * @param min The lower bound of each component.
+ * @param max The upper bound of each component.
+ * @param sampler The random stream to draw from.
+ * @return The random vector.
  */
-double random_double(double min, double max) {
-    static std::uniform_real_distribution<double> distribution(min, max);
-    static std::mt19937 generator;  // Mersenne Twister PRNG
-    return distribution(generator);
+inline vec3 random_vector(double min, double max, Sampler& sampler) {
+    double x = sampler.uniform(min, max);
+    double y = sampler.uniform(min, max);
+    double z = sampler.uniform(min, max);
+    return vec3(x, y, z);
 }
-    
+
 // Generates a random point inside a unit disk.
 /**
+ * @param sampler The random stream to draw from.
  * @return A random point inside a unit disk.
  */
-inline vec3 random_in_unit_disk() {
+inline vec3 random_in_unit_disk(Sampler& sampler) {
     while (true) {
-        auto p = vec3(random_double(-1, 1), random_double(-1, 1), 0);
+        double x = sampler.uniform(-1, 1);
+        double y = sampler.uniform(-1, 1);
+        auto p = vec3(x, y, 0);
         if (p.length_squared() < 1)
             return p;
     }
@@ -60,20 +52,22 @@ inline vec3 random_in_unit_disk() {
     
 // Samples a random point on the camera's defocus disk.
 /**
+ * @param sampler The random stream to draw from.
  * @return A random point on the defocus disk.
  */
-vec3 Camera::defocus_disk_sample() const {
-    auto p = random_in_unit_disk();
+vec3 Camera::defocus_disk_sample(Sampler& sampler) const {
+    auto p = random_in_unit_disk(sampler);
     return position + (p.x * defocus_disk_u) + (p.y * defocus_disk_v);
 }
 
 // Generates a random point inside a unit sphere.
 /**
+ * @param sampler The random stream to draw from.
  * @return A random point inside a unit sphere.
  */
-vec3 random_in_unit_sphere() {
+vec3 random_in_unit_sphere(Sampler& sampler) {
     while (true) {
-        auto p = vec3(random_double(-1, 1), random_double(-1, 1), random_double(-1, 1));
+        auto p = random_vector(-1, 1, sampler);
         if (p.length_squared() < 1)
             return p;
     }
@@ -81,11 +75,12 @@ vec3 random_in_unit_sphere() {
     
 // Generates a random point within a pixel.
 /**
+ * @param sampler The random stream to draw from.
  * @return A random point within the square surrounding a pixel.
  */
-vec3 Camera::pixel_sample_square() const {
-    auto px = -0.5 + random_double(-1, 1);
-    auto py = -0.5 + random_double(-1, 1);
+vec3 Camera::pixel_sample_square(Sampler& sampler) const {
+    auto px = -0.5 + sampler.uniform(-1, 1);
+    auto py = -0.5 + sampler.uniform(-1, 1);
     return (px * pixel_delta_u) + (py * pixel_delta_v);
 }
     
@@ -93,12 +88,13 @@ vec3 Camera::pixel_sample_square() const {
 /**
  * @param i The horizontal pixel index.
  * @param j The vertical pixel index.
+ * @param sampler The random stream of this pixel sample.
  * @return A ray originating from the camera through the specified pixel.
  */
-Ray Camera::get_ray(int i, int j) const {
+Ray Camera::get_ray(int i, int j, Sampler& sampler) const {
     auto pixel_center = pixel00_loc + (i * pixel_delta_u) + (j * pixel_delta_v);
-    auto pixel_sample = pixel_center + pixel_sample_square();
-    auto ray_origin = defocus_disk_sample();
+    auto pixel_sample = pixel_center + pixel_sample_square(sampler);
+    auto ray_origin = defocus_disk_sample(sampler);
     auto ray_direction = pixel_sample - ray_origin;
     return Ray(ray_origin, ray_direction, vec3(0, 0, 0), 0);
 }
@@ -168,7 +164,7 @@ void Camera::setCameraParameters(const vec3& position, const vec3& lookAt, const
 
     vec3 viewport_upper_left = position - (focal_length * w) - viewport_u / 2 - viewport_v / 2;
     pixel00_loc = viewport_upper_left + 0.5 * (pixel_delta_u + pixel_delta_v);
-    this->binaryRender = binaryRender;
+    this->renderMode = binaryRender ? RenderMode::Binary : RenderMode::Phong;
 
     auto defocus_radius = focus_dist * tan((defocus_angle * 3.14 / 180.0) / 2);
     defocus_disk_u = u * defocus_radius;
@@ -191,46 +187,72 @@ void Camera::setCameraParameters(const vec3& position, const vec3& lookAt, const
     for (int j = 0; j < imageHeight; ++j) {
         std::clog << "\rScanlines remaining: " << (imageHeight - j) << ' ' << std::flush;
         for (int i = 0; i < imageWidth; ++i) {
+            paintPixel(renderPixel(i, j, samplesPerPixel, world), outFile);
+        }
+    }
+    std::clog << "\rDone.                 \n";
+}
 
-            vec3 pixel_color(0, 0, 0);
-            vec3 temp_color(0, 0, 0);
-
-            for (int s = 0; s < samplesPerPixel; ++s) {
-                // Generate a ray for the current pixel
-                Ray r = get_ray(i, j);
-                
-                HitRecord rec;
-                // Check if the ray hits any object in the world
-                bool hit_return = world.hit(r, 0.001, std::numeric_limits<double>::infinity(), rec, 0);
-
-                if (hit_return) {
-                    if (!binaryRender) {
-                        // Accumulate the color from the ray
-                        temp_color = r.getColor();
-                        pixel_color += temp_color;
-                    } else {
-                        // Add a fixed color for binary rendering
-                        pixel_color += vec3(50, 50, 50);
-                    }
-                }
+// Computes the final color of one pixel.
+/**
+ * @param i The horizontal pixel index.
+ * @param j The vertical pixel index.
+ * @param samplesPerPixel The number of samples per pixel.
+ * @param world The world to render.
+ * @return The averaged color, the background color if nothing was hit, or red in binary mode.
+ */
+vec3 Camera::renderPixel(int i, int j, int samplesPerPixel, World& world) const {
+    vec3 pixel_color(0, 0, 0);
+    vec3 temp_color(0, 0, 0);
+    bool path_hit = false;
+
+    for (int s = 0; s < samplesPerPixel; ++s) {
+        // Every sample of every pixel has its own random stream
+        Sampler sampler(i, j, s);
+
+        // Generate a ray for the current pixel
+        Ray r = get_ray(i, j, sampler);
+
+        if (renderMode == RenderMode::Path) {
+            // Trace one full path per sample
+            if (world.tracePath(r, sampler, temp_color)) {
+                path_hit = true;
+                pixel_color += temp_color;
             }
+            continue;
+        }
 
-            if (pixel_color.length() == 0) {
-                // Paint the background color if no object is hit
-                paintPixel(background, outFile);
-            } 
-            else if (binaryRender) {
-                // Paint a fixed color for binary rendering
-                paintPixel(vec3(255, 0, 0), outFile);
-            }
-            else {
-                // Average the accumulated color and paint the pixel
-                pixel_color /= samplesPerPixel;
-                paintPixel(pixel_color, outFile);
+        if (renderMode == RenderMode::Binary) {
+            // Coverage only needs one covered sample, and no shading at all
+            if (world.anyHit(r)) {
+                return vec3(255, 0, 0);
             }
+            continue;
+        }
+        
+        HitRecord rec;
+        // Check if the ray hits any object in the world
+        bool hit_return = world.hit(r, 0.001, std::numeric_limits<double>::infinity(), rec, 0, sampler);
+
+        if (hit_return) {
+            // Accumulate the color from the ray
+            temp_color = r.getColor();
+            pixel_color += temp_color;
         }
     }
-    std::clog << "\rDone.                 \n";
+
+    if (renderMode == RenderMode::Path) {
+        // A fully shadowed hit can be black, so only a miss on every sample shows the background
+        return path_hit ? pixel_color / samplesPerPixel : background;
+    }
+
+    if (pixel_color.length() == 0 || renderMode == RenderMode::Binary) {
+        // Paint the background color if no object is hit
+        return background;
+    } 
+    // Average the accumulated color
+    pixel_color /= samplesPerPixel;
+    return pixel_color;
 }
 
 // Sets up the camera from JSON input.
@@ -256,6 +278,25 @@ void Camera::setupFromJson(const nlohmann::json& jsonInputCam, std::string Rende
     int imageWidth_loc = jsonInputCam["width"];
     double aspectRatio_loc = double(jsonInputCam["width"]) / double(jsonInputCam["height"]);
     bool binaryRender_loc = RenderModeString == "binary" ? true: false; 
+    bool pathRender_loc = RenderModeString == "path";
+
+    // The same camera renders every scene, so settings a scene leaves out go back to their defaults
+    setTileSize(defaultTileSize);
+    if (jsonInputCam.contains("tilesize")) {
+        setTileSize(jsonInputCam["tilesize"]);
+    }
+    setPacketTracing(true);
+    if (jsonInputCam.contains("packets")) {
+        setPacketTracing(jsonInputCam["packets"]);
+    }
+    setBackend(RenderBackend::Recursive);
+    if (jsonInputCam.contains("backend")) {
+        setBackend(jsonInputCam["backend"] == "wavefront" ? RenderBackend::Wavefront : RenderBackend::Recursive);
+    }
+    setRaySorting(true);
+    if (jsonInputCam.contains("sortrays")) {
+        setRaySorting(jsonInputCam["sortrays"]);
+    }
 
     setCameraParameters(position_loc,
                         lookAt_loc,
@@ -267,115 +308,258 @@ void Camera::setupFromJson(const nlohmann::json& jsonInputCam, std::string Rende
                         imageWidth_loc,
                         binaryRender_loc,
                         background);
+
+    if (pathRender_loc) {
+        setRenderMode(RenderMode::Path);
+    }
 }
 
-// Renders a chunk of the image.
+// Renders one block of pixels, tracing the camera rays of each sample as a packet.
 /**
+ * The block is RayPacket::width by RayPacket::height pixels, clipped to the tile.
+ * For every sample index the camera rays of all its pixels are traced together
+ * through the acceleration structure; each hit is then shaded on its own with the
+ * pixel sample's random stream, so the result matches renderPixel.
+ * @param x0 The left pixel of the block.
+ * @param y0 The top pixel of the block.
+ * @param tile The tile the block belongs to.
  * @param samplesPerPixel The number of samples per pixel.
  * @param world The world to render.
- * @param outputFile The output file path for the chunk.
- * @param startX The starting row of the chunk.
- * @param endX The ending row of the chunk.
+ * @param framebuffer The shared framebuffer the pixel colors are written into.
  */
-void Camera::renderChunk(int samplesPerPixel, World world, const std::string& outputFile, int startX, int endX) const {
-    std::ofstream outFile(outputFile);
-    outFile << "P3\n" << imageWidth << ' ' << (endX - startX) << "\n255\n";
+void Camera::renderPacket(int x0, int y0, const Tile& tile, int samplesPerPixel, World& world, Framebuffer& framebuffer) const {
+    const int size = RayPacket::size;
+    Sampler samplers[size];
+    HitRecord rec[size];
+    vec3 pixel_color[size];
+    RayPacket packet;
+
+    int pixels = 0;
+    for (int lane = 0; lane < size; ++lane) {
+        if (x0 + lane % RayPacket::width < tile.x1 && y0 + lane / RayPacket::width < tile.y1)
+            pixels |= 1 << lane;
+    }
 
-    for (int j = startX; j < endX; ++j) {
-        for (int i = 0; i < imageWidth; ++i) {
-            vec3 pixel_color(0, 0, 0);
-            vec3 temp_color(0, 0, 0);
-
-            for (int s = 0; s < samplesPerPixel; ++s) {
-                Ray r = get_ray(i, j);
-                HitRecord rec;
-                // Check if the ray hits any object in the world
-                bool hit_return = world.hit(r, 0.001, std::numeric_limits<double>::infinity(), rec, 0);
-
-                if (hit_return) {
-                    if (!binaryRender) {
-                        // Accumulate the color from the ray
-                        temp_color = r.getColor();
-                        pixel_color += temp_color;
-                    }
-                    else{
-                        // Add a fixed color for binary rendering
-                        pixel_color += vec3(50, 50, 50);
-                    }
-                }
+    int covered = 0;
+    for (int s = 0; s < samplesPerPixel; ++s) {
+        packet.clear();
+        for (int lane = 0; lane < size; ++lane) {
+            // Coverage only needs one covered sample, so covered pixels drop out
+            if (!(pixels & ~covered & (1 << lane))) continue;
+            int i = x0 + lane % RayPacket::width;
+            int j = y0 + lane / RayPacket::width;
+            samplers[lane] = Sampler(i, j, s);
+            packet.set(lane, get_ray(i, j, samplers[lane]));
+        }
+        if (!packet.activeMask()) break;
+
+        if (renderMode == RenderMode::Binary) {
+            covered |= world.anyHitPacket(packet);
+            continue;
+        }
+
+        int hits = world.hitPacket(packet, rec);
+        for (int lane = 0; lane < size; ++lane) {
+            if (!(hits & (1 << lane))) continue;
+            Ray r = packet.ray(lane);
+            world.shade(r, 0.001, std::numeric_limits<double>::infinity(), rec[lane], 0, samplers[lane]);
+            pixel_color[lane] += r.getColor();
+        }
+    }
+
+    for (int lane = 0; lane < size; ++lane) {
+        if (!(pixels & (1 << lane))) continue;
+        vec3 color = background;
+        if (renderMode == RenderMode::Binary) {
+            if (covered & (1 << lane)) color = vec3(255, 0, 0);
+        }
+        else if (pixel_color[lane].length() != 0) {
+            color = pixel_color[lane] / samplesPerPixel;
+        }
+        framebuffer.setPixel(x0 + lane % RayPacket::width, y0 + lane / RayPacket::width, color);
+    }
+}
+
+// Renders one tile with the wavefront backend.
+/**
+ * The camera rays of as many whole samples as fit in a batch are traced together.
+ * Results are added up per pixel in sample order and resolved as in renderPixel;
+ * in binary mode pixels that are already covered get no more samples.
+ * @param tile The tile to render.
+ * @param samplesPerPixel The number of samples per pixel.
+ * @param wavefront The wavefront renderer of this worker.
+ * @param framebuffer The shared framebuffer the pixel colors are written into.
+ */
+void Camera::renderWavefront(const Tile& tile, int samplesPerPixel, Wavefront& wavefront, Framebuffer& framebuffer) const {
+    int tileWidth = tile.x1 - tile.x0;
+    int pixels = tileWidth * (tile.y1 - tile.y0);
+    std::vector<vec3> pixel_color(pixels, vec3(0, 0, 0));
+    std::vector<char> pixel_hit(pixels, 0);
+    std::vector<int> rootPixel;
+
+    int samplesPerBatch = std::max(1, Wavefront::batchSize / std::max(1, pixels));
+    for (int s0 = 0; s0 < samplesPerPixel; s0 += samplesPerBatch) {
+        int s1 = std::min(samplesPerPixel, s0 + samplesPerBatch);
+        wavefront.clear();
+        rootPixel.clear();
+        for (int s = s0; s < s1; ++s) {
+            for (int p = 0; p < pixels; ++p) {
+                // Coverage only needs one covered sample
+                if (renderMode == RenderMode::Binary && pixel_hit[p]) continue;
+                int i = tile.x0 + p % tileWidth;
+                int j = tile.y0 + p / tileWidth;
+                Sampler sampler(i, j, s);
+                Ray r = get_ray(i, j, sampler);
+                wavefront.addCameraRay(r, sampler);
+                rootPixel.push_back(p);
             }
+        }
+        if (rootPixel.empty()) break;
 
-            if (pixel_color.length() == 0) {
-                // Paint the background color if no object is hit
-                paintPixel(background, outFile);
-            } 
-            else if (binaryRender) {
-                // Paint a fixed color for binary rendering
-                paintPixel(vec3(255, 0, 0), outFile);
+        wavefront.trace(renderMode);
+        for (size_t root = 0; root < rootPixel.size(); ++root) {
+            if (!wavefront.hit(int(root))) continue;
+            pixel_hit[rootPixel[root]] = 1;
+            pixel_color[rootPixel[root]] += wavefront.getColor(int(root));
+        }
+    }
+
+    for (int p = 0; p < pixels; ++p) {
+        vec3 color = background;
+        if (renderMode == RenderMode::Binary) {
+            if (pixel_hit[p]) color = vec3(255, 0, 0);
+        }
+        else if (renderMode == RenderMode::Path) {
+            // A fully shadowed hit can be black, so only a miss on every sample shows the background
+            if (pixel_hit[p]) color = pixel_color[p] / samplesPerPixel;
+        }
+        else if (pixel_color[p].length() != 0) {
+            color = pixel_color[p] / samplesPerPixel;
+        }
+        framebuffer.setPixel(tile.x0 + p % tileWidth, tile.y0 + p / tileWidth, color);
+    }
+}
+
+// Renders tiles handed out by the scheduler until none are left.
+/**
+ * @param worker The index of this worker in the scheduler.
+ * @param samplesPerPixel The number of samples per pixel.
+ * @param world The world to render.
+ * @param scheduler The tile scheduler shared by all workers.
+ * @param framebuffer The shared framebuffer the pixel colors are written into.
+ */
+void Camera::renderTiles(int worker, int samplesPerPixel, World& world, TileScheduler& scheduler, Framebuffer& framebuffer) const {
+    Tile tile;
+    if (backend == RenderBackend::Wavefront) {
+        // The ray buffers are kept for the worker's whole run, so only this backend builds them
+        Wavefront wavefront(world);
+        wavefront.setRaySorting(sortRays);
+        while (scheduler.next(worker, tile)) {
+            renderWavefront(tile, samplesPerPixel, wavefront, framebuffer);
+        }
+        return;
+    }
+
+    while (scheduler.next(worker, tile)) {
+        // Path tracing scatters after the first hit, so only the other modes use packets
+        if (packetTracing && renderMode != RenderMode::Path) {
+            for (int j = tile.y0; j < tile.y1; j += RayPacket::height) {
+                for (int i = tile.x0; i < tile.x1; i += RayPacket::width) {
+                    renderPacket(i, j, tile, samplesPerPixel, world, framebuffer);
+                }
             }
-            else {
-                // Average the accumulated color and paint the pixel
-                pixel_color /= samplesPerPixel;
-                paintPixel(pixel_color, outFile);
+            continue;
+        }
+        for (int j = tile.y0; j < tile.y1; ++j) {
+            for (int i = tile.x0; i < tile.x1; ++i) {
+                framebuffer.setPixel(i, j, renderPixel(i, j, samplesPerPixel, world));
             }
         }
     }
-    std::clog << "\rDone.                 \n";
 }
 
-// Combines image chunks into one final image.
+// Sets the render mode.
 /**
- * @param filename The output file path for the combined image.
- * @param chunkFiles A vector of file paths for the image chunks.
+ * @param renderMode How camera rays are turned into pixel colors.
  */
-void Camera::combineImagesIntoOne(const std::string& filename, const std::vector<std::string>& chunkFiles) {
-    std::ofstream outFile(filename);
+void Camera::setRenderMode(RenderMode renderMode) {
+    this->renderMode = renderMode;
+}
 
-    // Write PPM header
-    outFile << "P3\n" << imageWidth << ' ' << imageHeight << "\n255\n";
+// Sets the render backend.
+/**
+ * @param backend Whether the rays of a tile are traced depth-first or in waves.
+ */
+void Camera::setBackend(RenderBackend backend) {
+    this->backend = backend;
+}
 
-    // Concatenate individual chunk files into the final image
-    for (const auto& chunkFile : chunkFiles) {
-        std::ifstream chunkInFile(chunkFile);
-        outFile << chunkInFile.rdbuf();
-    }
+// Turns sorting of secondary rays in the wavefront backend on or off.
+/**
+ * @param sortRays True to sort every wave after the camera rays by direction and origin.
+ */
+void Camera::setRaySorting(bool sortRays) {
+    this->sortRays = sortRays;
+}
+
+// Turns tracing camera rays in packets on or off.
+/**
+ * @param packetTracing True to trace camera rays in packets, false to trace them one by one.
+ */
+void Camera::setPacketTracing(bool packetTracing) {
+    this->packetTracing = packetTracing;
+}
+
+// Sets the edge length of render tiles.
+/**
+ * @param tileSize The tile edge length in pixels.
+ */
+void Camera::setTileSize(int tileSize) {
+    this->tileSize = tileSize > 0 ? tileSize : 1;
 }
 
 // Renders the scene in parallel using multiple threads.
 /**
- * @param numThreads The number of threads to use.
+ * The image is split into square tiles which the workers pull from a
+ * work-stealing scheduler, so expensive regions are shared out instead of
+ * stalling the thread that owns them. Workers write straight into the framebuffer.
+ * @param numThreads The number of threads to use, or 0 for one per hardware thread.
  * @param samplesPerPixel The number of samples per pixel.
  * @param world The world to render.
- * @param outputFileName The output file path for the rendered image.
+ * @param framebuffer Receives the rendered image; it is resized to the camera's image size.
  */
-void Camera::renderParallel(int numThreads, int samplesPerPixel, World& world, const std::string& outputFileName) {
-    std::vector<std::string> temp_files;
-    for (int i = 0; i < numThreads; i++) {
-        temp_files.push_back("temp_out" + std::to_string(i) + ".ppm");
+void Camera::renderParallel(int numThreads, int samplesPerPixel, World& world, Framebuffer& framebuffer) {
+    if (numThreads <= 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
     }
-    int rowsPerThread = imageHeight / numThreads;
+
+    framebuffer.resize(imageWidth, imageHeight);
+    TileScheduler scheduler(imageWidth, imageHeight, tileSize, numThreads);
+    std::cout << "Rendering " << scheduler.tileCount() << " tiles of " << tileSize << "x" << tileSize
+              << " on " << numThreads << " threads" << std::endl;
 
     // Create threads
     std::vector<std::thread> threads;
     for (int t = 0; t < numThreads; ++t) {
-        int startRow = t * rowsPerThread;
-        int endRow = (t + 1 == numThreads) ? imageHeight : (t + 1) * rowsPerThread;
-
-        const std::string& sceneFile = temp_files[t];
-        std::cout <<sceneFile <<std::endl; 
-        threads.emplace_back(std::bind(&Camera::renderChunk, this, samplesPerPixel, std::ref(world), sceneFile, startRow, endRow));
+        threads.emplace_back(&Camera::renderTiles, this, t, samplesPerPixel, std::ref(world), std::ref(scheduler), std::ref(framebuffer));
     }
 
     // Join threads
     for (auto& thread : threads) {
         thread.join();
     }
+    std::clog << "\rDone.                 \n";
+}
 
-    // Combine images vertically
-    combineImagesVertically(temp_files, outputFileName);
-
-    // Remove temporary files
-    for (auto& temp_file : temp_files) {
-        removeFile(temp_file);
-    }
+// Renders the scene in parallel and writes it to a PPM file.
+/**
+ * @param numThreads The number of threads to use, or 0 for one per hardware thread.
+ * @param samplesPerPixel The number of samples per pixel.
+ * @param world The world to render.
+ * @param outputFileName The output file path for the rendered image.
+ */
+void Camera::renderParallel(int numThreads, int samplesPerPixel, World& world, const std::string& outputFileName) {
+    Framebuffer framebuffer;
+    renderParallel(numThreads, samplesPerPixel, world, framebuffer);
+    framebuffer.writePPM(outputFileName);
 }
\ No newline at end of file
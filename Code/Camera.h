@@ -6,11 +6,34 @@
 #include "vector.h"  
 #include "Ray.h"     
 #include "world.h"
+#include "tile_scheduler.h"
+#include "framebuffer.h"
+#include "sampler.h"
 #include <fstream>
 #include <thread>
 #include "json-develop/single_include/nlohmann/json.hpp"
 
 class World;
+class Wavefront;
+
+/**
+ * @enum RenderMode
+ * @brief Selects how camera rays are turned into pixel colors.
+ */
+enum class RenderMode {
+    Phong,  ///< Recursive Phong shading with hemisphere-sampled reflections.
+    Binary, ///< Hit or miss only.
+    Path    ///< Iterative path tracing with next-event estimation.
+};
+
+/**
+ * @enum RenderBackend
+ * @brief Selects the order in which the rays of a tile are traced.
+ */
+enum class RenderBackend {
+    Recursive, ///< Each sample is traced depth-first to completion.
+    Wavefront  ///< All rays of a bounce are traced together, breadth-first.
+};
 
 /**
  * @class Camera
@@ -21,6 +44,8 @@ public:
     double defocus_angle = 3;  // Variation angle of rays through each pixel
     double focus_dist = 0.5;
 
+    static const int defaultTileSize = 16; // Tile edge length used when a scene does not set one.
+
     Camera() {} // Default constructor.
     Camera(const vec3& position, const vec3& lookAt, const vec3& up, 
            double fov, double aspectRatio, double aperture, double focusDistance, int imageWidth, bool binaryRender, vec3 background); // Constructor.
@@ -31,13 +56,21 @@ public:
     void render(int samplesPerPixel, World world, const std::string& outputFile) const; // Renders the scene.
     void setupFromJson(const nlohmann::json& jsonInputCam, std::string RenderModeString, vec3 background); // Sets up the camera from JSON input.
     vec3 getPosition(); // Gets the camera's position.
-    void renderChunk(int samplesPerPixel, World world, const std::string& outputFile, int startX, int endX) const; // Renders a chunk of the image.
-    void combineImagesIntoOne(const std::string& filename, const std::vector<std::string>& chunkFiles); // Combines image chunks into one.
-    void renderParallel(int numThreads, int samplesPerPixel, World& world, const std::string& outputFileName); // Renders the scene in parallel.
+    vec3 renderPixel(int i, int j, int samplesPerPixel, World& world) const; // Computes the final color of one pixel.
+    void renderPacket(int x0, int y0, const Tile& tile, int samplesPerPixel, World& world, Framebuffer& framebuffer) const; // Renders one block of pixels with packets of camera rays.
+    void renderWavefront(const Tile& tile, int samplesPerPixel, Wavefront& wavefront, Framebuffer& framebuffer) const; // Renders one tile with the wavefront backend.
+    void renderTiles(int worker, int samplesPerPixel, World& world, TileScheduler& scheduler, Framebuffer& framebuffer) const; // Renders tiles until none are left.
+    void setTileSize(int tileSize); // Sets the edge length of render tiles.
+    void setPacketTracing(bool packetTracing); // Turns tracing camera rays in packets on or off.
+    void setRenderMode(RenderMode renderMode); // Sets the render mode.
+    void setBackend(RenderBackend backend); // Sets the render backend.
+    void setRaySorting(bool sortRays); // Turns sorting of secondary rays in the wavefront backend on or off.
+    void renderParallel(int numThreads, int samplesPerPixel, World& world, Framebuffer& framebuffer); // Renders the scene in parallel into a framebuffer.
+    void renderParallel(int numThreads, int samplesPerPixel, World& world, const std::string& outputFileName); // Renders the scene in parallel to a file.
     Ray getRay(double u, double v) const; // Generates a ray for a given pixel (u, v).
-    vec3 defocus_disk_sample() const; // Samples a point on the defocus disk.
-    Ray get_ray(int i, int j) const; // Generates a ray for a specific pixel.
-    vec3 pixel_sample_square() const; // Samples a point within a pixel.
+    vec3 defocus_disk_sample(Sampler& sampler) const; // Samples a point on the defocus disk.
+    Ray get_ray(int i, int j, Sampler& sampler) const; // Generates a ray for a specific pixel.
+    vec3 pixel_sample_square(Sampler& sampler) const; // Samples a point within a pixel.
 
 private:
     vec3 position;          // Camera position.
@@ -52,10 +85,14 @@ private:
     vec3 pixel00_loc;       // Location of pixel (0, 0).
     vec3 pixel_delta_u;     // Offset to the next pixel to the right.
     vec3 pixel_delta_v;     // Offset to the next pixel below.
-    bool binaryRender;      // Flag for binary rendering mode.
+    RenderMode renderMode;  // How camera rays are shaded.
     vec3 background;        // Background color.
     vec3 defocus_disk_u;    // Horizontal radius of the defocus disk.
     vec3 defocus_disk_v;    // Vertical radius of the defocus disk.
+    int tileSize = defaultTileSize; // Edge length of a render tile in pixels.
+    bool packetTracing = true; // Trace camera rays in packets in the Phong and binary modes.
+    RenderBackend backend = RenderBackend::Recursive; // Order in which the rays of a tile are traced.
+    bool sortRays = true;   // Sort secondary rays in the wavefront backend.
 };
 
 #endif // CAMERA_H
\ No newline at end of file
@@ -1,7 +1,15 @@
 CXX = g++
-CXXFLAGS = -std=c++11 -Wall -pthread
+CXXFLAGS = -std=c++11 -Wall -pthread -O2 -fno-math-errno
+# Per-ISA kernel variants: vectorize their loops at -O2 and never fuse multiply-adds, so every variant rounds alike
+CXXFLAGS += -fvect-cost-model=dynamic -ffp-contract=off
 
-SRC = raytracer.cpp vector.cpp Ray.cpp Camera.cpp color.cpp Sphere.cpp world.cpp triangle.cpp cylinder.cpp circle.cpp Material.cpp tonemapping.cpp texture.cpp combine_ppms.cpp
+# Floating-point type of the geometry: double (default) or float
+PRECISION ?= double
+ifeq ($(PRECISION),float)
+CXXFLAGS += -DRT_SINGLE_PRECISION
+endif
+
+SRC = raytracer.cpp Ray.cpp Camera.cpp color.cpp Sphere.cpp world.cpp triangle.cpp mesh.cpp instance.cpp matrix4.cpp cylinder.cpp circle.cpp Material.cpp tonemapping.cpp texture.cpp aabb.cpp accelerator.cpp bvh.cpp wide_bvh.cpp lazy_bvh.cpp sphere_cluster.cpp primitives.cpp grid.cpp tile_scheduler.cpp framebuffer.cpp sampler.cpp ray_packet.cpp wavefront.cpp cpu_dispatch.cpp
 TARGET = a
 
 all: $(TARGET)
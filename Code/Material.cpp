@@ -52,7 +52,7 @@ Material Material::getMaterialFromJson(const nlohmann::json& jsonInput) {
 /**
  * @return The diffuse color (RGB).
  */
-vec3 Material::getDiffuseColor() {
+vec3 Material::getDiffuseColor() const {
     return diffusecolor;
 }
 
@@ -60,7 +60,7 @@ vec3 Material::getDiffuseColor() {
 /**
  * @return The specular color (RGB).
  */
-vec3 Material::getSpecularColor() {
+vec3 Material::getSpecularColor() const {
     return specularcolor;
 }
 
@@ -84,7 +84,7 @@ void Material::setSpecularColor(vec3 new_color) {
 /**
  * @return The specular exponent.
  */
-float Material::getSpecularexponent() {
+float Material::getSpecularexponent() const {
     return specularexponent;
 }
 
@@ -92,7 +92,7 @@ float Material::getSpecularexponent() {
 /**
  * @return The diffuse color (RGB).
  */
-vec3 Material::getDiffusecolor() {
+vec3 Material::getDiffusecolor() const {
     return diffusecolor;
 }
 
@@ -100,7 +100,7 @@ vec3 Material::getDiffusecolor() {
 /**
  * @return The specular color (RGB).
  */
-vec3 Material::getSpecularcolor() {
+vec3 Material::getSpecularcolor() const {
     return specularcolor;
 }
 
@@ -108,7 +108,7 @@ vec3 Material::getSpecularcolor() {
 /**
  * @return True if the material is reflective, false otherwise.
  */
-bool Material::getIsreflective() {
+bool Material::getIsreflective() const {
     return isreflective;
 }
 
@@ -116,7 +116,7 @@ bool Material::getIsreflective() {
 /**
  * @return The reflectivity value.
  */
-float Material::getReflectivity() {
+float Material::getReflectivity() const {
     return reflectivity;
 }
 
@@ -124,7 +124,7 @@ float Material::getReflectivity() {
 /**
  * @return True if the material is refractive, false otherwise.
  */
-bool Material::getIsrefractive() {
+bool Material::getIsrefractive() const {
     return isrefractive;
 }
 
@@ -132,7 +132,7 @@ bool Material::getIsrefractive() {
 /**
  * @return The refractive index.
  */
-float Material::getRefractiveindex() {
+float Material::getRefractiveindex() const {
     return refractiveindex;
 }
 
@@ -140,7 +140,7 @@ float Material::getRefractiveindex() {
 /**
  * @return The specular reflection coefficient.
  */
-float Material::getKs() {
+float Material::getKs() const {
     return ks;
 }
 
@@ -148,16 +148,33 @@ float Material::getKs() {
 /**
  * @return The diffuse reflection coefficient.
  */
-float Material::getKd() {
+float Material::getKd() const {
     return kd;
 }
 
 // Sets the texture of the material.
 /**
- * @param path The file path to the texture.
+ * @param path The file path to the texture, shared through the process-wide texture cache.
  */
 void Material::setTexture(const std::string& path) {
-    texture.loadPPM(path);
+    texture = Texture::load(path);
+    textureIsSet = true;
+}
+
+// Checks if the material has a texture.
+/**
+ * @return True if a texture is set, false otherwise.
+ */
+bool Material::hasTexture() const {
+    return textureIsSet;
+}
+
+// Gets the shared texture image of the material.
+/**
+ * @return The texture handle, or null if the material is untextured.
+ */
+std::shared_ptr<const Texture> Material::getTextureHandle() const {
+    return texture;
 }
 
 // Gets the texture color at the specified UV coordinates.
@@ -167,5 +184,5 @@ void Material::setTexture(const std::string& path) {
  * @return The texture color at the specified UV coordinates.
  */
 vec3 Material::getTexture(float u, float v) const {
-    return texture.getColor(u, v);
+    return texture->getColor(u, v);
 }
\ No newline at end of file
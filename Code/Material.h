@@ -5,6 +5,7 @@
 #include <fstream>
 #include <sstream>
 #include <iomanip>
+#include <memory>
 #include "vector.h"
 #include "json-develop/single_include/nlohmann/json.hpp"
 #include "texture.h"
@@ -24,7 +25,7 @@ private:
     float reflectivity;  // Reflectivity value.
     bool isrefractive;   // Refractivity flag.
     float refractiveindex; // Refractive index.
-    Texture texture;     // Texture object.
+    std::shared_ptr<const Texture> texture; // Shared texture image, null if untextured.
     bool textureIsSet;   // Texture flag.
 
 public:
@@ -33,19 +34,19 @@ public:
     reflectivity(0.0), isrefractive(false), refractiveindex(0.0), textureIsSet(false)  {}
 
 
-    vec3 getDiffuseColor(); // Gets the diffuse color.
-    vec3 getSpecularColor(); // Gets the specular color.
+    vec3 getDiffuseColor() const; // Gets the diffuse color.
+    vec3 getSpecularColor() const; // Gets the specular color.
     void setDiffuseColor(vec3 new_color); // Sets the diffuse color.
     void setSpecularColor(vec3 new_color); // Sets the specular color.
-    float getSpecularexponent(); // Gets the specular exponent.
-    vec3 getDiffusecolor(); // Gets the diffuse color (alternative).
-    vec3 getSpecularcolor(); // Gets the specular color (alternative).
-    bool getIsreflective(); // Checks if the material is reflective.
-    float getReflectivity(); // Gets the reflectivity value.
-    bool getIsrefractive(); // Checks if the material is refractive.
-    float getRefractiveindex(); // Gets the refractive index.
-    float getKs(); // Gets the specular reflection coefficient.
-    float getKd(); // Gets the diffuse reflection coefficient.
+    float getSpecularexponent() const; // Gets the specular exponent.
+    vec3 getDiffusecolor() const; // Gets the diffuse color (alternative).
+    vec3 getSpecularcolor() const; // Gets the specular color (alternative).
+    bool getIsreflective() const; // Checks if the material is reflective.
+    float getReflectivity() const; // Gets the reflectivity value.
+    bool getIsrefractive() const; // Checks if the material is refractive.
+    float getRefractiveindex() const; // Gets the refractive index.
+    float getKs() const; // Gets the specular reflection coefficient.
+    float getKd() const; // Gets the diffuse reflection coefficient.
 
     static Material getMaterial(float ks, float kd, float specularexponent, vec3 diffusecolor, vec3 specularcolor, 
                                 bool isreflective, float reflectivity, bool isrefractive, float refractiveindex); // Creates a material.
@@ -53,6 +54,8 @@ public:
     static Material getMaterialFromJson(const nlohmann::json& jsonInput); // Creates a material from JSON input.
 
     void setTexture(const std::string& path); // Sets the texture.
+    bool hasTexture() const; // Checks if a texture is set.
+    std::shared_ptr<const Texture> getTextureHandle() const; // Gets the shared texture image.
     vec3 getTexture(float u, float v) const; // Gets the texture color at UV coordinates.
 };
 
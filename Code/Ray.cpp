@@ -22,18 +22,6 @@ Ray::Ray() {
 Ray::Ray(const vec3& origin, const vec3& direction, const vec3& color, int depth)
     : origin(origin), direction(direction), color(color), depth(depth) {}
 
-// Gets the ray's origin.
-/**
- * @return The origin of the ray.
- */
-vec3 Ray::getOrigin() const { return origin; }
-
-// Gets the ray's direction.
-/**
- * @return The direction of the ray.
- */
-vec3 Ray::getDirection() const { return direction; }
-
 // Sets the ray's direction.
 /**
  * @param new_direction The new direction to set for the ray.
@@ -58,13 +46,6 @@ void Ray::setColor(vec3 newcolor) { color = newcolor; }
  */
 int Ray::getDepth() const { return depth; }
 
-// Computes a point along the ray at parameter t.
-/**
- * @param t The parameter value along the ray.
- * @return The point at parameter t.
- */
-vec3 Ray::pointAtParameter(float t) const { return origin + t * direction; }
-
 // Clamps the ray's color values to a unit vector.
 /**
  * Ensures the ray's color values are normalized.
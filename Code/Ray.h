@@ -18,12 +18,12 @@ public:
     Ray(); // Default constructor.
     Ray(const vec3& origin, const vec3& direction, const vec3& color, int depth); // Constructor.
 
-    vec3 getOrigin() const; // Gets the ray's origin.
-    vec3 getDirection() const; // Gets the ray's direction.
+    const vec3& getOrigin() const { return origin; } // Gets the ray's origin.
+    const vec3& getDirection() const { return direction; } // Gets the ray's direction.
     void setDirection(vec3 new_direction); // Sets the ray's direction.
     vec3 getColor() const; // Gets the ray's color.
     void setColor(vec3 newcolor); // Sets the ray's color.
-    vec3 pointAtParameter(float t) const; // Computes a point along the ray at parameter t.
+    vec3 pointAtParameter(real t) const { return origin + t * direction; } // Computes a point along the ray at parameter t.
     vec3 get_normalized() const; // Gets the normalized direction of the ray.
     int getDepth() const; // Gets the ray's depth.
     void clampColour(); // Clamps the ray's color values.
@@ -1,4 +1,5 @@
 #include "Sphere.h"
+#include "cpu_dispatch.h"
 
 // Checks for a grid-based intersection with the sphere.
 /**
@@ -8,21 +9,9 @@
  * @param rec The record to store hit information.
  * @return True if the ray intersects the grid, false otherwise.
  */
-bool Sphere::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    double t0 = std::numeric_limits<double>::lowest();
-    double t1 = std::numeric_limits<double>::max();
-    if (!hitBoundingBox(r, t0, t1))
-        return false;
-
-    // Ensure the intersection is within the valid range
-    t0 = std::max(t0, t_min);
-    t1 = std::min(t1, t_max);
-
-    // Check if the ray misses the grid
-    if (t0 >= t1)
-        return false;
-
-    return true;
+bool Sphere::gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    // The baked box test already clips against the valid range
+    return hitBoundingBox(r, t_min, t_max);
 }
 
 // Checks for a ray-bounding box intersection.
@@ -30,95 +19,204 @@ bool Sphere::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) c
  * @param r The ray to test.
  * @param t0 The minimum t value for a valid hit.
  * @param t1 The maximum t value for a valid hit.
- * @return True if the ray intersects the bounding box, false otherwise.
+ * @return True if the ray intersects the baked bounding box, false otherwise.
  */
-bool Sphere::hitBoundingBox(const Ray& r, double t0, double t1) const {
-    vec3 center_min = center - vec3(radius, radius, radius);
-    vec3 center_max = center + vec3(radius, radius, radius);
-
-    double center_min_arr[] = {center_min.x, center_min.y, center_min.z};
-    double center_max_arr[] = {center_max.x, center_max.y, center_max.z};
-    vec3 ray_direction = r.getDirection();
-    double ray_direction_arr[] = {ray_direction.x, ray_direction.y, ray_direction.z};
-    vec3 ray_origin = r.getOrigin();
-    double ray_origin_arr[] = {ray_origin.x, ray_origin.y, ray_origin.z};
-
-    for (int i = 0; i < 3; ++i) {
-        double invD = 1.0 / (0.0001 + ray_direction_arr[i]);
-        double tNear = (center_min_arr[i] - ray_origin_arr[i]) * invD;
-        double tFar = (center_max_arr[i] - ray_origin_arr[i]) * invD;
-
-        if (invD < 0.0)
-            std::swap(tNear, tFar);
-
-        t0 = tNear > t0 ? tNear : t0;
-        t1 = tFar < t1 ? tFar : t1;
-
-        if (t0 >= t1)
-            return false;
-    }
+bool Sphere::hitBoundingBox(const Ray& r, real t0, real t1) const {
+    vec3 d = r.getDirection();
+    return box.hit(r.getOrigin(), vec3(1.0 / d.x, 1.0 / d.y, 1.0 / d.z), t0, t1);
+}
+
+// Moves the sphere center and scales its radius.
+/**
+ * @param transform The transform to apply.
+ */
+void Sphere::transform(const Matrix4& transform) {
+    center = transform.transformPoint(center);
+    radius *= transform.scaleFactor();
+    bake();
+}
 
-    return true;
+// Precomputes the data used by the intersection routines.
+void Sphere::bake() {
+    radiusSquared = radius * radius;
+    invRadius = 1.0 / radius;
+    vec3 r(radius, radius, radius);
+    box = AABB(center - r, center + r);
+}
+
+// Gets the bounding box of the sphere.
+/**
+ * @return The baked box spanning the sphere center plus or minus the radius.
+ */
+AABB Sphere::bounds() const {
+    return box;
 }
 
 // Checks for a ray-sphere intersection.
 /**
+ * No box test comes first: the acceleration structure has already tested the
+ * sphere's box, and the quadratic is about as cheap as a second slab test.
  * @param r The ray to test.
  * @param t_min The minimum t value for a valid hit.
  * @param t_max The maximum t value for a valid hit.
- * @param rec The record to store hit information.
+ * @param info Receives the hit distance.
  * @return True if the ray intersects the sphere, false otherwise.
  */
-bool Sphere::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    if (!gridHit(r, t_min, t_max, rec)) return false;
-
+bool Sphere::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
     vec3 oc = r.getOrigin() - center;
-    double a = vec3::dot(r.getDirection(), r.getDirection());
-    double b = vec3::dot(oc, r.getDirection());
-    double c = vec3::dot(oc, oc) - radius * radius;
-    double discriminant = b * b - a * c;
+    real a = vec3::dot(r.getDirection(), r.getDirection());
+    real b = vec3::dot(oc, r.getDirection());
+    real c = vec3::dot(oc, oc) - radiusSquared;
+    real discriminant = b * b - a * c;
 
     if (discriminant > 0) {
-        double temp = (-b - sqrt(discriminant)) / a;
+        real root = sqrt(discriminant);
+        real temp = (-b - root) / a;
         if (temp < t_max && temp > t_min) {
-            rec.material = this->material;
-            rec.t = temp;
-            rec.p = r.pointAtParameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-
-            if (textureIsSet) {
-                double u = 0.5 + atan2(rec.normal.z, rec.normal.x) / (2 * 3.14);
-                double v = 0.5 - asin(rec.normal.y) / 3.14;
-                rec.material.setDiffuseColor(material.getTexture(u, v));
-            }
-            rec.normal.return_unit();
+            info.t = temp;
+            info.depth = 0;
             return true;
         }
-        temp = (-b + sqrt(discriminant)) / a;
+        temp = (-b + root) / a;
         if (temp < t_max && temp > t_min) {
-            rec.material = this->material;
-            rec.t = temp;
-            rec.p = r.pointAtParameter(rec.t);
-            rec.normal = (rec.p - center) / radius;
-
-            if (textureIsSet) {
-                double u = 0.5 + atan2(rec.normal.z, rec.normal.x) / (2 * 3.14);
-                double v = 0.5 - asin(rec.normal.y) / 3.14;
-                rec.material.setDiffuseColor(material.getTexture(u, v));
-            }
-            rec.normal.return_unit();
+            info.t = temp;
+            info.depth = 0;
             return true;
         }
     }
     return false;
 }
 
+// Fills in the hit record at the distance found by intersect.
+/**
+ * @param r The ray that hit the sphere.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void Sphere::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    rec.materialId = materialId;
+    rec.textured = textureIsSet;
+    rec.t = info.t;
+    rec.p = r.pointAtParameter(rec.t);
+    rec.normal = (rec.p - center) * invRadius;
+
+    if (textureIsSet) {
+        real u = 0.5 + atan2(rec.normal.z, rec.normal.x) / (2 * 3.14);
+        real v = 0.5 - asin(rec.normal.y) / 3.14;
+        rec.textureColor = texture->getColor(u, v);
+    }
+}
+
+// Checks if the sphere blocks a ray segment.
+/**
+ * Only solves for the roots; no hit point, normal or texture is computed.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True if either intersection lies within [t_min, t_max], false otherwise.
+ */
+bool Sphere::occludes(const Ray& r, real t_min, real t_max) const {
+    vec3 oc = r.getOrigin() - center;
+    real a = vec3::dot(r.getDirection(), r.getDirection());
+    real b = vec3::dot(oc, r.getDirection());
+    real c = vec3::dot(oc, oc) - radiusSquared;
+    real discriminant = b * b - a * c;
+
+    if (discriminant <= 0) return false;
+
+    real root = sqrt(discriminant);
+    real temp = (-b - root) / a;
+    if (temp < t_max && temp > t_min) return true;
+    temp = (-b + root) / a;
+    return temp < t_max && temp > t_min;
+}
+
+namespace {
+
+// Packet sphere test, compiled once per instruction set level below.
+RT_ALWAYS_INLINE int sphereRootsKernel(const RayPacket& packet, const vec3& center, real radiusSquared, RayPacket::Lanes& t) {
+    typedef RayPacket::Lanes Lanes;
+    typedef RayPacket::LaneMask LaneMask;
+
+    Lanes ocx = packet.ox - center.x;
+    Lanes ocy = packet.oy - center.y;
+    Lanes ocz = packet.oz - center.z;
+    Lanes a = packet.dx * packet.dx + packet.dy * packet.dy + packet.dz * packet.dz;
+    Lanes b = ocx * packet.dx + ocy * packet.dy + ocz * packet.dz;
+    Lanes c = ocx * ocx + ocy * ocy + ocz * ocz - radiusSquared;
+    Lanes discriminant = b * b - a * c;
+
+    Lanes zero = {};
+    LaneMask crosses = discriminant > zero;
+    Lanes root = crosses ? discriminant : zero;
+    RayPacket::sqrt(root);
+    Lanes nearRoot = (-b - root) / a;
+    Lanes farRoot = (-b + root) / a;
+    LaneMask nearIn = crosses & (nearRoot < packet.tMax) & (nearRoot > packet.tMin);
+    LaneMask farIn = crosses & (farRoot < packet.tMax) & (farRoot > packet.tMin);
+    t = nearIn ? nearRoot : farRoot;
+    return RayPacket::bits(nearIn | farIn);
+}
+
+RT_ISA_VARIANTS(int, sphereRoots, (const RayPacket& packet, const vec3& center, real radiusSquared, RayPacket::Lanes& t),
+                (packet, center, radiusSquared, t))
+
+} // namespace
+
+// Finds the nearest root in range of every ray in a packet.
+/**
+ * Runs the same arithmetic as Sphere::intersect on all lanes at once, so each
+ * lane finds exactly the root the single-ray test would. The lanes are processed
+ * with the widest vector instructions the CPU offers.
+ * @param packet The rays, each with its own range.
+ * @param center The sphere center.
+ * @param radiusSquared The squared sphere radius.
+ * @param t Receives the root of each lane that has one in range.
+ * @return The bit mask of lanes with a root in range.
+ */
+int Sphere::packetRoots(const RayPacket& packet, const vec3& center, real radiusSquared, RayPacket::Lanes& t) {
+    return sphereRoots(packet, center, radiusSquared, t);
+}
+
+// Finds where the rays of a packet hit the sphere.
+/**
+ * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+ * @param mask The lanes to test.
+ * @param info Receives the hit distance of each lane that hits.
+ * @return The bit mask of lanes that hit the sphere.
+ */
+int Sphere::intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const {
+    RayPacket::Lanes t;
+    int hits = packetRoots(packet, center, radiusSquared, t) & mask;
+    for (int lane = 0; lane < RayPacket::size; ++lane) {
+        if (!(hits & (1 << lane))) continue;
+        info[lane].t = t[lane];
+        info[lane].depth = 0;
+        packet.tMax[lane] = t[lane];
+    }
+    return hits;
+}
+
+// Checks which rays of a packet the sphere blocks.
+/**
+ * @param packet The rays, each with its own range.
+ * @param mask The lanes to test.
+ * @return The bit mask of lanes the sphere blocks.
+ */
+int Sphere::occludesPacket(const RayPacket& packet, int mask) const {
+    RayPacket::Lanes t;
+    return packetRoots(packet, center, radiusSquared, t) & mask;
+}
+
 // Sets the material of the sphere.
 /**
- * @param material The material to set.
+ * @param materialId The index of the material in the world's material table.
+ * @param material The material itself, used to pick up its shared texture.
  */
-void Sphere::setMaterial(Material material) {
-    this->material = material;
+void Sphere::setMaterial(int materialId, const Material& material) {
+    this->materialId = materialId;
+    this->texture = material.getTextureHandle();
+    this->textureIsSet = material.hasTexture();
 }
 
 // Sets the light color of the sphere.
@@ -141,15 +239,14 @@ vec3 Sphere::getLightColour() {
 /**
  * @return The center position of the sphere.
  */
-vec3 Sphere::getPosition() {
+vec3 Sphere::getPosition() const {
     return center;
 }
 
-// Sets the texture of the sphere.
+// Gets the radius of the sphere.
 /**
- * @param texturePath The file path to the texture.
+ * @return The radius of the sphere.
  */
-void Sphere::setTexture(const std::string& texturePath) {
-    this->material.setTexture(texturePath);
-    this->textureIsSet = true;
+real Sphere::getRadius() const {
+    return radius;
 }
\ No newline at end of file
@@ -8,24 +8,36 @@
  * @class Sphere
  * @brief Represents a sphere that can be hit by rays.
  */
-class Sphere : public Hittable {
+class Sphere final : public Hittable {
 public:
-    Sphere() : textureIsSet(false) {} // Default constructor.
-    Sphere(const vec3& center, double radius) : center(center), radius(radius), textureIsSet(false) {} // Constructor.
+    Sphere() : radius(0), radiusSquared(0), invRadius(0), materialId(0), textureIsSet(false) {} // Default constructor.
+    Sphere(const vec3& center, real radius) : center(center), radius(radius), radiusSquared(0), invRadius(0), materialId(0), textureIsSet(false) {} // Constructor.
 
     vec3 getLightColour(); // Gets the light color.
     void setLightColour(vec3 lightCol); // Sets the light color.
-    vec3 getPosition(); // Gets the sphere's position.
-    void setMaterial(Material material); // Sets the sphere's material.
-    void setTexture(const std::string& texturePath); // Sets the sphere's texture.
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override; // Checks for ray-sphere intersection.
-    bool gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const; // Grid-based intersection check.
-    bool hitBoundingBox(const Ray& r, double t0, double t1) const; // Checks for ray-bounding box intersection.
+    vec3 getPosition() const; // Gets the sphere's position.
+    real getRadius() const; // Gets the sphere's radius.
+    void setMaterial(int materialId, const Material& material); // Sets the sphere's material from the world's material table.
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Checks for ray-sphere intersection.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record at the hit distance.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if the sphere blocks a ray segment.
+    virtual int intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const override; // Tests every ray of a packet at once.
+    virtual int occludesPacket(const RayPacket& packet, int mask) const override; // Checks which rays of a packet the sphere blocks.
+    static int packetRoots(const RayPacket& packet, const vec3& center, real radiusSquared, RayPacket::Lanes& t); // Finds each ray's nearest root in range.
+    virtual void transform(const Matrix4& transform) override; // Moves the sphere center and scales its radius.
+    virtual void bake() override; // Precomputes the squared and reciprocal radius and the bounding box.
+    virtual AABB bounds() const override; // Gets the sphere's bounding box.
+    bool gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const; // Grid-based intersection check.
+    bool hitBoundingBox(const Ray& r, real t0, real t1) const; // Checks for ray-bounding box intersection.
 
 private:
     vec3 center;          // Sphere center.
-    double radius;        // Sphere radius.
-    Material material;    // Sphere material.
+    real radius;        // Sphere radius.
+    real radiusSquared; // Baked squared radius.
+    real invRadius;     // Baked reciprocal radius.
+    AABB box;             // Baked bounding box.
+    int materialId;       // Index into the world's material table.
+    std::shared_ptr<const Texture> texture; // Shared texture of the material, null if untextured.
     vec3 ligthColour;     // Light color.
     bool textureIsSet;    // Texture flag.
 };
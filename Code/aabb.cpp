@@ -0,0 +1,118 @@
+#include "aabb.h"
+#include <limits>
+#include <algorithm>
+
+// Default constructor: creates an empty (inverted) box.
+/**
+ * Any point or box expanded into an empty box becomes its new extent.
+ */
+AABB::AABB()
+    : min(std::numeric_limits<real>::max(), std::numeric_limits<real>::max(), std::numeric_limits<real>::max()),
+      max(std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest(), std::numeric_limits<real>::lowest()) {}
+
+// Constructor: Initializes the box from its two corners.
+/**
+ * @param min The minimum corner.
+ * @param max The maximum corner.
+ */
+AABB::AABB(const vec3& min, const vec3& max) : min(min), max(max) {}
+
+// Grows the box to contain a point.
+/**
+ * @param point The point to include.
+ */
+void AABB::expand(const vec3& point) {
+    min = vec3(std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z));
+    max = vec3(std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z));
+}
+
+// Grows the box to contain another box.
+/**
+ * @param other The box to include.
+ */
+void AABB::expand(const AABB& other) {
+    min = vec3(std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z));
+    max = vec3(std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z));
+}
+
+// Checks if the box is empty.
+/**
+ * @return True if the box has not been expanded by anything, false otherwise.
+ */
+bool AABB::isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+}
+
+// Gets the center of the box.
+/**
+ * @return The centroid of the box.
+ */
+vec3 AABB::centroid() const {
+    return 0.5 * (min + max);
+}
+
+// Gets the size of the box along each axis.
+/**
+ * @return The extent of the box.
+ */
+vec3 AABB::extent() const {
+    return max - min;
+}
+
+// Gets the surface area of the box.
+/**
+ * @return The surface area, or 0 for an empty box.
+ */
+double AABB::surfaceArea() const {
+    if (isEmpty()) return 0.0;
+    vec3 e = extent();
+    return 2.0 * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+// Gets the index of the longest axis of the box.
+/**
+ * @return 0 for x, 1 for y, 2 for z.
+ */
+int AABB::longestAxis() const {
+    vec3 e = extent();
+    if (e.x > e.y && e.x > e.z) return 0;
+    return e.y > e.z ? 1 : 2;
+}
+
+// Checks for a ray-box intersection using the slab method.
+/**
+ * @param origin The ray origin.
+ * @param invDirection The component-wise inverse of the ray direction.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True if the ray overlaps the box within [t_min, t_max], false otherwise.
+ */
+bool AABB::hit(const vec3& origin, const vec3& invDirection, real t_min, real t_max) const {
+    for (int i = 0; i < 3; ++i) {
+        real tNear = (min[i] - origin[i]) * invDirection[i];
+        real tFar = (max[i] - origin[i]) * invDirection[i];
+
+        if (tNear > tFar)
+            std::swap(tNear, tFar);
+
+        t_min = tNear > t_min ? tNear : t_min;
+        t_max = tFar < t_max ? tFar : t_max;
+
+        if (t_min > t_max)
+            return false;
+    }
+
+    return true;
+}
+
+// Returns the union of two boxes.
+/**
+ * @param a The first box.
+ * @param b The second box.
+ * @return The smallest box containing both boxes.
+ */
+AABB AABB::merge(const AABB& a, const AABB& b) {
+    AABB result = a;
+    result.expand(b);
+    return result;
+}
@@ -0,0 +1,30 @@
+#ifndef AABB_H
+#define AABB_H
+
+#include "vector.h"
+
+/**
+ * @class AABB
+ * @brief Axis-aligned bounding box used by the acceleration structures.
+ */
+class AABB {
+public:
+    vec3 min; ///< Minimum corner of the box.
+    vec3 max; ///< Maximum corner of the box.
+
+    AABB(); // Default constructor, creates an empty box.
+    AABB(const vec3& min, const vec3& max); // Constructor from two corners.
+
+    void expand(const vec3& point); // Grows the box to contain a point.
+    void expand(const AABB& other); // Grows the box to contain another box.
+    bool isEmpty() const; // Checks if the box contains nothing.
+    vec3 centroid() const; // Gets the center of the box.
+    vec3 extent() const; // Gets the size of the box along each axis.
+    double surfaceArea() const; // Gets the surface area of the box.
+    int longestAxis() const; // Gets the index of the longest axis.
+    bool hit(const vec3& origin, const vec3& invDirection, real t_min, real t_max) const; // Slab test against the box.
+
+    static AABB merge(const AABB& a, const AABB& b); // Returns the union of two boxes.
+};
+
+#endif // AABB_H
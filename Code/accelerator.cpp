@@ -0,0 +1,78 @@
+#include "accelerator.h"
+#include "wide_bvh.h"
+#include "grid.h"
+#include "lazy_bvh.h"
+#include <iostream>
+
+// Creates an accelerator by name.
+/**
+ * @param type The accelerator name from the scene file ("bvh", "lazy", "grid" or "linear").
+ * @return A new, unbuilt accelerator. Unknown names fall back to a BVH.
+ */
+std::shared_ptr<Accelerator> Accelerator::create(const std::string& type) {
+    if (type == "linear") {
+        return std::make_shared<LinearAccelerator>();
+    }
+    if (type == "grid") {
+        return std::make_shared<GridAccelerator>();
+    }
+    if (type == "lazy") {
+        return std::make_shared<LazyBVHAccelerator>();
+    }
+    if (type != "bvh") {
+        std::cerr << "Unknown accelerator \"" << type << "\", using bvh." << std::endl;
+    }
+    return std::make_shared<BVHAccelerator>();
+}
+
+// Copies the objects to test.
+/**
+ * @param objects The objects to index.
+ */
+void LinearAccelerator::build(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    prims.build(objects);
+}
+
+// Finds the closest intersection by testing every object.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param rec The record to store hit information.
+ * @return True if the ray hits an object, false otherwise.
+ */
+bool LinearAccelerator::hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    HitInfo info;
+    int closest = -1;
+    real closest_so_far = t_max;
+
+    for (int object = 0; object < int(prims.size()); ++object) {
+        if (prims.intersect(object, r, t_min, closest_so_far, info)) {
+            closest = object;
+            closest_so_far = info.t;
+        }
+    }
+    if (closest < 0) return false;
+
+    prims.surface(closest, r, info, rec);
+    return true;
+}
+
+
+// Checks if any object blocks a ray segment.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param blocker If not null, receives the object that blocked the ray.
+ * @return True as soon as one object blocks the segment, false otherwise.
+ */
+bool LinearAccelerator::occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker) const {
+    for (int object = 0; object < int(prims.size()); ++object) {
+        if (prims.occludes(object, r, t_min, t_max)) {
+            if (blocker) *blocker = prims.get(object);
+            return true;
+        }
+    }
+    return false;
+}
\ No newline at end of file
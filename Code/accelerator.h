@@ -0,0 +1,111 @@
+#ifndef ACCELERATOR_H
+#define ACCELERATOR_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include "hittable.h"
+#include "primitives.h"
+
+/**
+ * @class Accelerator
+ * @brief Abstract base class for structures that answer ray queries against the world's objects.
+ */
+class Accelerator {
+public:
+    virtual ~Accelerator() {}
+
+    /**
+     * @brief Builds the structure over a list of objects.
+     * @param objects The objects to index.
+     */
+    virtual void build(const std::vector<std::shared_ptr<Hittable>>& objects) = 0;
+
+    /**
+     * @brief Brings the structure up to date after the indexed objects moved in place.
+     * The default rebuilds from scratch; structures that can refit override it.
+     * @param objects The same objects, in the same order, as passed to build.
+     */
+    virtual void update(const std::vector<std::shared_ptr<Hittable>>& objects) {
+        build(objects);
+    }
+
+    /**
+     * @brief Finds the closest intersection of a ray with the indexed objects.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param rec The record to store hit information.
+     * @return True if the ray hits an object, false otherwise.
+     */
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const = 0;
+
+    /**
+     * @brief Checks if any indexed object blocks a ray segment, stopping at the first blocker.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param blocker If not null, receives the object that blocked the ray.
+     * @return True if the segment is blocked, false otherwise.
+     */
+    virtual bool occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker = nullptr) const = 0;
+
+    /**
+     * @brief Finds the closest hits of a packet of rays.
+     * The default answers the rays one by one; structures that can walk them
+     * together override it.
+     * @param packet The rays, each with its own range; the range of every ray that hits is shrunk to the hit.
+     * @param rec Receives the hit record of each lane that hits, indexed by lane.
+     * @return The bit mask of lanes that hit an object.
+     */
+    virtual int hitPacket(RayPacket& packet, HitRecord rec[]) const {
+        int hits = 0;
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if ((packet.activeMask() & (1 << lane)) && hit(packet.ray(lane), packet.tMin, packet.tMax[lane], rec[lane])) {
+                packet.tMax[lane] = rec[lane].t;
+                hits |= 1 << lane;
+            }
+        }
+        return hits;
+    }
+
+    /**
+     * @brief Checks which rays of a packet are blocked by any indexed object.
+     * @param packet The rays, each with its own range.
+     * @return The bit mask of lanes whose segment is blocked.
+     */
+    virtual int occludedPacket(const RayPacket& packet) const {
+        int blocked = 0;
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if ((packet.activeMask() & (1 << lane)) && occluded(packet.ray(lane), packet.tMin, packet.tMax[lane])) {
+                blocked |= 1 << lane;
+            }
+        }
+        return blocked;
+    }
+
+    /**
+     * @brief Gets the name of the accelerator as used in scene files.
+     * @return The accelerator name.
+     */
+    virtual std::string name() const = 0;
+
+    static std::shared_ptr<Accelerator> create(const std::string& type); // Creates an accelerator by name.
+};
+
+/**
+ * @class LinearAccelerator
+ * @brief Tests every object for every ray; kept as a reference and fallback.
+ */
+class LinearAccelerator : public Accelerator {
+public:
+    virtual void build(const std::vector<std::shared_ptr<Hittable>>& objects) override; // Copies the objects.
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const override; // Loops over all objects.
+    virtual bool occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker = nullptr) const override; // Loops until the first blocker.
+    virtual std::string name() const override { return "linear"; }
+
+private:
+    PrimitiveArrays prims; // Copies of the objects to test.
+};
+
+#endif // ACCELERATOR_H
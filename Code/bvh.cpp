@@ -0,0 +1,184 @@
+#include "bvh.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const int numBins = 12;              // SAH bins per axis.
+const double traversalCost = 1.0;    // Relative cost of visiting an inner node.
+const double intersectionCost = 1.0; // Relative cost of one primitive test.
+
+struct Bin {
+    AABB bounds;
+    int count = 0;
+};
+
+// Maps a centroid coordinate to its SAH bin.
+int binIndex(double c, double cmin, double scale) {
+    int b = int((c - cmin) * scale);
+    return std::min(numBins - 1, std::max(0, b));
+}
+
+} // namespace
+
+// Builds the hierarchy over a list of primitive boxes.
+/**
+ * @param primBounds The bounding box of each primitive, indexed by primitive id.
+ * @param maxLeafSize The largest number of primitives a leaf may hold.
+ */
+void BVH::build(const std::vector<AABB>& primBounds, int maxLeafSize) {
+    nodes.clear();
+    primIndices.clear();
+    if (primBounds.empty()) return;
+
+    std::vector<vec3> centroids;
+    centroids.reserve(primBounds.size());
+    primIndices.reserve(primBounds.size());
+    for (size_t i = 0; i < primBounds.size(); ++i) {
+        centroids.push_back(primBounds[i].centroid());
+        primIndices.push_back(int(i));
+    }
+
+    // A binary tree over N leaves has at most 2N - 1 nodes
+    nodes.reserve(2 * primBounds.size());
+    BVHNode root;
+    root.leftFirst = 0;
+    root.count = int(primBounds.size());
+    root.axis = 0;
+    nodes.push_back(root);
+
+    subdivide(0, 0, primBounds, centroids, maxLeafSize);
+}
+
+// Recursively splits a node using the binned surface area heuristic.
+/**
+ * @param nodeIndex The node to split.
+ * @param depth The depth of the node in the tree.
+ * @param primBounds The bounding box of each primitive.
+ * @param centroids The centroid of each primitive box.
+ * @param maxLeafSize The largest number of primitives a leaf may hold.
+ */
+void BVH::subdivide(int nodeIndex, int depth, const std::vector<AABB>& primBounds,
+                    const std::vector<vec3>& centroids, int maxLeafSize) {
+    int first = nodes[nodeIndex].leftFirst;
+    int count = nodes[nodeIndex].count;
+
+    AABB bounds;
+    for (int i = first; i < first + count; ++i) {
+        bounds.expand(primBounds[primIndices[i]]);
+    }
+    nodes[nodeIndex].bounds = bounds;
+
+    if (depth >= maxDepth) return;
+
+    int axis;
+    int mid = partition(primIndices, first, count, bounds, primBounds, centroids, maxLeafSize, axis);
+    if (mid < 0) return;
+
+    int leftIndex = int(nodes.size());
+    BVHNode left, right;
+    left.leftFirst = first;
+    left.count = mid - first;
+    left.axis = 0;
+    right.leftFirst = mid;
+    right.count = first + count - mid;
+    right.axis = 0;
+    nodes.push_back(left);
+    nodes.push_back(right);
+
+    nodes[nodeIndex].leftFirst = leftIndex;
+    nodes[nodeIndex].count = 0;
+    nodes[nodeIndex].axis = axis;
+
+    subdivide(leftIndex, depth + 1, primBounds, centroids, maxLeafSize);
+    subdivide(leftIndex + 1, depth + 1, primBounds, centroids, maxLeafSize);
+}
+
+// Splits a range of primitives in two using the binned surface area heuristic.
+/**
+ * Only the given range of primIndices is reordered, so ranges owned by different
+ * nodes can be split at the same time.
+ * @param primIndices The primitive order; the range is partitioned in place.
+ * @param first The first slot of the range.
+ * @param count The number of primitives in the range.
+ * @param bounds The box of all primitives in the range.
+ * @param primBounds The bounding box of each primitive.
+ * @param centroids The centroid of each primitive box.
+ * @param maxLeafSize The largest number of primitives a leaf may hold.
+ * @param axis Receives the split axis.
+ * @return The first slot of the right half, or -1 if the range should stay a leaf.
+ */
+int BVH::partition(std::vector<int>& primIndices, int first, int count, const AABB& bounds,
+                   const std::vector<AABB>& primBounds, const std::vector<vec3>& centroids,
+                   int maxLeafSize, int& axis) {
+    if (count <= 1) return -1;
+
+    AABB centroidBounds;
+    for (int i = first; i < first + count; ++i) {
+        centroidBounds.expand(centroids[primIndices[i]]);
+    }
+
+    // Find the cheapest split plane over all three axes
+    int bestAxis = -1;
+    int bestSplit = 0;
+    double bestCost = std::numeric_limits<double>::max();
+    for (int candidateAxis = 0; candidateAxis < 3; ++candidateAxis) {
+        double cmin = centroidBounds.min[candidateAxis];
+        double cmax = centroidBounds.max[candidateAxis];
+        if (cmax <= cmin) continue;
+        double scale = numBins / (cmax - cmin);
+
+        Bin bins[numBins];
+        for (int i = first; i < first + count; ++i) {
+            Bin& bin = bins[binIndex(centroids[primIndices[i]][candidateAxis], cmin, scale)];
+            bin.bounds.expand(primBounds[primIndices[i]]);
+            bin.count++;
+        }
+
+        // Sweep from both sides to get the area and count on each side of every plane
+        double leftArea[numBins - 1], rightArea[numBins - 1];
+        int leftCount[numBins - 1], rightCount[numBins - 1];
+        AABB leftBox, rightBox;
+        int leftSum = 0, rightSum = 0;
+        for (int i = 0; i < numBins - 1; ++i) {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+            leftBox.expand(bins[i].bounds);
+            leftArea[i] = leftBox.surfaceArea();
+
+            rightSum += bins[numBins - 1 - i].count;
+            rightCount[numBins - 2 - i] = rightSum;
+            rightBox.expand(bins[numBins - 1 - i].bounds);
+            rightArea[numBins - 2 - i] = rightBox.surfaceArea();
+        }
+
+        for (int i = 0; i < numBins - 1; ++i) {
+            if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+            double cost = leftArea[i] * leftCount[i] + rightArea[i] * rightCount[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = candidateAxis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    if (bestAxis < 0) {
+        // All centroids coincide; split by index so leaves stay small
+        if (count <= maxLeafSize) return -1;
+        axis = bounds.longestAxis();
+        return first + count / 2;
+    }
+
+    double area = bounds.surfaceArea();
+    double splitCost = traversalCost + intersectionCost * bestCost / (area > 0 ? area : 1.0);
+    double leafCost = intersectionCost * count;
+    if (count <= maxLeafSize && leafCost <= splitCost) return -1;
+
+    double cmin = centroidBounds.min[bestAxis];
+    double scale = numBins / (centroidBounds.max[bestAxis] - cmin);
+    int* middle = std::partition(primIndices.data() + first, primIndices.data() + first + count,
+        [&](int prim) { return binIndex(centroids[prim][bestAxis], cmin, scale) <= bestSplit; });
+    axis = bestAxis;
+    return int(middle - primIndices.data());
+}
@@ -0,0 +1,141 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <memory>
+#include "aabb.h"
+#include "Ray.h"
+
+/**
+ * @struct BVHNode
+ * @brief A node of a flattened bounding volume hierarchy.
+ *
+ * Children of an inner node are stored next to each other, so only the index
+ * of the left child is kept; the right child is at leftFirst + 1.
+ */
+struct BVHNode {
+    AABB bounds;   ///< Bounds of everything below this node.
+    int leftFirst; ///< Left child index for inner nodes, first primitive slot for leaves.
+    int count;     ///< Number of primitives in a leaf, 0 for inner nodes.
+    int axis;      ///< Split axis of an inner node, used to visit the nearer child first.
+
+    bool isLeaf() const { return count > 0; }
+};
+
+/**
+ * @class BVH
+ * @brief Surface-area-heuristic bounding volume hierarchy over a set of primitive boxes.
+ *
+ * The hierarchy only knows about boxes; the caller supplies the primitive test
+ * at query time, so the same builder serves any kind of primitive list.
+ */
+class BVH {
+public:
+    BVH() {} // Default constructor.
+
+    void build(const std::vector<AABB>& primBounds, int maxLeafSize = 4); // Builds the hierarchy.
+    bool empty() const { return nodes.empty(); } // Checks if the hierarchy has been built.
+    const std::vector<BVHNode>& getNodes() const { return nodes; } // Gets the flattened node array.
+    const std::vector<int>& getPrimIndices() const { return primIndices; } // Gets the leaf primitive order.
+
+    /**
+     * @brief Walks the hierarchy and reports the closest primitive hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim, real t_min, real& t_max) that tests one
+     *                primitive and shrinks t_max on a hit.
+     * @return True if any primitive was hit, false otherwise.
+     */
+    template <typename PrimHit>
+    bool closestHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (nodes.empty()) return false;
+
+        vec3 origin = r.getOrigin();
+        vec3 direction = r.getDirection();
+        vec3 invDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+        bool hit_anything = false;
+        int stack[maxDepth + 2];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BVHNode& node = nodes[stack[--stackSize]];
+            if (!node.bounds.hit(origin, invDirection, t_min, t_max))
+                continue;
+
+            if (node.isLeaf()) {
+                for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                    if (primHit(primIndices[i], t_min, t_max))
+                        hit_anything = true;
+                }
+                continue;
+            }
+
+            // Push the far child first so the near child is visited first
+            if (direction[node.axis] < 0) {
+                stack[stackSize++] = node.leftFirst;
+                stack[stackSize++] = node.leftFirst + 1;
+            } else {
+                stack[stackSize++] = node.leftFirst + 1;
+                stack[stackSize++] = node.leftFirst;
+            }
+        }
+        return hit_anything;
+    }
+
+    /**
+     * @brief Walks the hierarchy until any primitive reports a hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim) that tests one primitive against [t_min, t_max].
+     * @return True as soon as a primitive is hit, false if none is.
+     */
+    template <typename PrimHit>
+    bool anyHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (nodes.empty()) return false;
+
+        vec3 origin = r.getOrigin();
+        vec3 direction = r.getDirection();
+        vec3 invDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+        int stack[maxDepth + 2];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            const BVHNode& node = nodes[stack[--stackSize]];
+            if (!node.bounds.hit(origin, invDirection, t_min, t_max))
+                continue;
+
+            if (node.isLeaf()) {
+                for (int i = node.leftFirst; i < node.leftFirst + node.count; ++i) {
+                    if (primHit(primIndices[i]))
+                        return true;
+                }
+                continue;
+            }
+
+            stack[stackSize++] = node.leftFirst + 1;
+            stack[stackSize++] = node.leftFirst;
+        }
+        return false;
+    }
+
+    static const int maxDepth = 64; // Deepest level the builder will create.
+
+    static int partition(std::vector<int>& primIndices, int first, int count, const AABB& bounds,
+                         const std::vector<AABB>& primBounds, const std::vector<vec3>& centroids,
+                         int maxLeafSize, int& axis); // Splits a primitive range with the binned SAH.
+
+private:
+    void subdivide(int nodeIndex, int depth, const std::vector<AABB>& primBounds,
+                   const std::vector<vec3>& centroids, int maxLeafSize); // Recursively splits a node.
+
+    std::vector<BVHNode> nodes;   // Flattened nodes, root at index 0.
+    std::vector<int> primIndices; // Primitive indices in leaf order.
+};
+
+#endif // BVH_H
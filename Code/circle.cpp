@@ -7,10 +7,13 @@
  * @param normal The normal vector of the circle.
  * @param cylinderHeight The height of the cylinder the circle is part of.
  */
-Circle::Circle(const vec3& center, double radius, const vec3& normal, double cylinderHeight) {
+Circle::Circle(const vec3& center, real radius, const vec3& normal, real cylinderHeight) {
     this->center = center;
     this->radius = radius;
     this->normal = const_cast<vec3&>(normal).return_unit();
+    this->radiusSquared = 0;
+    this->planeOffset = 0;
+    this->materialId = 0;
     this->textureIsSet = false;
     this->cylinderHeight = cylinderHeight;
 }
@@ -23,23 +26,9 @@ Circle::Circle(const vec3& center, double radius, const vec3& normal, double cyl
  * @param rec The record to store hit information.
  * @return True if the ray intersects the grid, false otherwise.
  */
-bool Circle::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    double t0 = std::numeric_limits<double>::lowest();
-    double t1 = std::numeric_limits<double>::max();
-
-    // Check if the ray intersects the bounding box of the cylinder
-    if (!hitBoundingBox(r, t0, t1))
-        return false;
-
-    // Ensure the intersection is within the valid range
-    t0 = std::max(t0, t_min);
-    t1 = std::min(t1, t_max);
-
-    // Check if the ray misses the grid
-    if (t0 >= t1)
-        return false;
-
-    return true;
+bool Circle::gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    // The baked box test already clips against the valid range
+    return hitBoundingBox(r, t_min, t_max);
 }
 
 // Checks for a ray-bounding box intersection.
@@ -47,35 +36,46 @@ bool Circle::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) c
  * @param r The ray to test.
  * @param t0 The minimum t value for a valid hit.
  * @param t1 The maximum t value for a valid hit.
- * @return True if the ray intersects the bounding box, false otherwise.
+ * @return True if the ray intersects the baked bounding box, false otherwise.
  */
-bool Circle::hitBoundingBox(const Ray& r, double& t0, double& t1) const {
-    vec3 min = (center - 0.5 * cylinderHeight * normal) - vec3(radius, cylinderHeight / 2, radius);
-    vec3 max = (center - 0.5 * cylinderHeight * normal) + vec3(radius, cylinderHeight / 2, radius);
-
-    double min_arr[] = {min.x, min.y, min.z};
-    double max_arr[] = {max.x, max.y, max.z};
-    vec3 ray_direction = r.getDirection();
-    double ray_direction_arr[] = {ray_direction.x, ray_direction.y, ray_direction.z};
-    vec3 ray_origin = r.getOrigin();
-    double ray_origin_arr[] = {ray_origin.x, ray_origin.y, ray_origin.z};
-
-    for (int i = 0; i < 3; ++i) {
-        double invD = 1.0 / (0.0001 + ray_direction_arr[i]);
-        double tNear = (min_arr[i] - ray_origin_arr[i]) * invD;
-        double tFar = (max_arr[i] - ray_origin_arr[i]) * invD;
-
-        if (invD < 0.0)
-            std::swap(tNear, tFar);
-
-        t0 = tNear > t0 ? tNear : t0;
-        t1 = tFar < t1 ? tFar : t1;
-
-        if (t0 >= t1)
-            return false;
-    }
+bool Circle::hitBoundingBox(const Ray& r, real t0, real t1) const {
+    vec3 d = r.getDirection();
+    return box.hit(r.getOrigin(), vec3(1.0 / d.x, 1.0 / d.y, 1.0 / d.z), t0, t1);
+}
+
+// Moves the center, turns the normal and scales the disc.
+/**
+ * @param transform The transform to apply.
+ */
+void Circle::transform(const Matrix4& transform) {
+    real scale = transform.scaleFactor();
+    center = transform.transformPoint(center);
+    normal = transform.transformVector(normal).return_unit();
+    radius *= scale;
+    cylinderHeight *= scale;
+    bake();
+}
+
+// Precomputes the data used by the intersection routines.
+/**
+ * A disc with unit normal n extends by radius * sqrt(1 - n_i^2) along each world axis i.
+ */
+void Circle::bake() {
+    radiusSquared = radius * radius;
+    planeOffset = vec3::dot(normal, center);
+
+    vec3 e(radius * std::sqrt(std::max(0.0, 1.0 - normal.x * normal.x)),
+           radius * std::sqrt(std::max(0.0, 1.0 - normal.y * normal.y)),
+           radius * std::sqrt(std::max(0.0, 1.0 - normal.z * normal.z)));
+    box = AABB(center - e, center + e);
+}
 
-    return true;
+// Gets the bounding box of the circle.
+/**
+ * @return The baked box enclosing the disc.
+ */
+AABB Circle::bounds() const {
+    return box;
 }
 
 // Checks for a ray-circle intersection.
@@ -83,61 +83,80 @@ bool Circle::hitBoundingBox(const Ray& r, double& t0, double& t1) const {
  * @param r The ray to test.
  * @param t_min The minimum t value for a valid hit.
  * @param t_max The maximum t value for a valid hit.
- * @param rec The record to store hit information.
+ * @param info Receives the hit distance.
  * @return True if the ray intersects the circle, false otherwise.
  */
-bool Circle::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    if (!gridHit(r, t_min, t_max, rec)) return false;
+bool Circle::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    if (!hitBoundingBox(r, t_min, t_max)) return false;
 
-    double denom = vec3::dot(r.getDirection(), normal);
+    real denom = vec3::dot(r.getDirection(), normal);
     if (std::abs(denom) < 1e-6) {
         return false;
     }
 
     // Calculate the parameter t for the intersection point
-    double t = vec3::dot(center - r.getOrigin(), normal) / denom;
+    real t = (planeOffset - vec3::dot(r.getOrigin(), normal)) / denom;
 
     // Check if the intersection point is within the given range
     if (t < t_min || t > t_max) {
         return false;
     }
 
-    // Calculate the intersection point and record the information
-    vec3 intersection_point = r.pointAtParameter(t);
-    vec3 to_center = intersection_point - center;
-    double distance_squared = to_center.length_squared();
-
-    if (distance_squared <= radius * radius) {
-        rec.t = t;
-        rec.p = intersection_point;
-        rec.normal = normal;
-        rec.material = this->material;
-
-        if (textureIsSet) {
-            double u = 0.5 + atan2(normal.z, normal.x) / (2 * 3.14);
-            double v = 0.5 - asin(normal.y) / 3.14;
-            rec.material.setDiffuseColor(material.getTexture(u, v));
-        }
-        rec.normal.return_unit();
+    vec3 to_center = r.pointAtParameter(t) - center;
+    if (to_center.length_squared() <= radiusSquared) {
+        info.t = t;
+        info.depth = 0;
         return true;
     }
 
     return false;
 }
 
-// Sets the material of the circle.
+// Fills in the hit record at the distance found by intersect.
+/**
+ * @param r The ray that hit the circle.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void Circle::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    rec.t = info.t;
+    rec.p = r.pointAtParameter(info.t);
+    rec.normal = normal;
+    rec.materialId = materialId;
+    rec.textured = textureIsSet;
+
+    if (textureIsSet) {
+        real u = 0.5 + atan2(normal.z, normal.x) / (2 * 3.14);
+        real v = 0.5 - asin(normal.y) / 3.14;
+        rec.textureColor = texture->getColor(u, v);
+    }
+}
+
+// Checks if the circle blocks a ray segment.
 /**
- * @param material The material to set.
+ * Only intersects the plane and checks the distance to the center; no texture is computed.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True if the ray crosses the disc within [t_min, t_max], false otherwise.
  */
-void Circle::setMaterial(Material material) {
-    this->material = material;
+bool Circle::occludes(const Ray& r, real t_min, real t_max) const {
+    real denom = vec3::dot(r.getDirection(), normal);
+    if (std::abs(denom) < 1e-6) return false;
+
+    real t = (planeOffset - vec3::dot(r.getOrigin(), normal)) / denom;
+    if (t < t_min || t > t_max) return false;
+
+    return (r.pointAtParameter(t) - center).length_squared() <= radiusSquared;
 }
 
-// Sets the texture of the circle.
+// Sets the material of the circle.
 /**
- * @param texturePath The file path to the texture.
+ * @param materialId The index of the material in the world's material table.
+ * @param material The material itself, used to pick up its shared texture.
  */
-void Circle::setTexture(const std::string& texturePath) {
-    this->material.setTexture(texturePath);
-    this->textureIsSet = true;
+void Circle::setMaterial(int materialId, const Material& material) {
+    this->materialId = materialId;
+    this->texture = material.getTextureHandle();
+    this->textureIsSet = material.hasTexture();
 }
\ No newline at end of file
@@ -8,25 +8,33 @@
  * @class Circle
  * @brief Represents a circle that can be hit by rays.
  */
-class Circle : public Hittable {
+class Circle final : public Hittable {
 public:
-    Circle() : textureIsSet(false) {} // Default constructor.
-    Circle(const vec3& center, double radius, const vec3& normal, double cylinderHeight); // Constructor.
+    Circle() : radius(0), radiusSquared(0), planeOffset(0), materialId(0), textureIsSet(false), cylinderHeight(0) {} // Default constructor.
+    Circle(const vec3& center, real radius, const vec3& normal, real cylinderHeight); // Constructor.
 
-    void setMaterial(Material material); // Sets the circle's material.
-    void setTexture(const std::string& texturePath); // Sets the circle's texture.
-    bool gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const; // Grid-based intersection check.
-    bool hitBoundingBox(const Ray& r, double& t0, double& t1) const; // Checks for ray-bounding box intersection.
+    void setMaterial(int materialId, const Material& material); // Sets the circle's material from the world's material table.
+    bool gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const; // Grid-based intersection check.
+    bool hitBoundingBox(const Ray& r, real t0, real t1) const; // Checks for ray-bounding box intersection.
 
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override; // Checks for ray-circle intersection.
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Checks for ray-circle intersection.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record at the hit distance.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if the circle blocks a ray segment.
+    virtual void transform(const Matrix4& transform) override; // Moves the center and turns the normal.
+    virtual void bake() override; // Precomputes the squared radius, plane offset and bounding box.
+    virtual AABB bounds() const override; // Gets the circle's bounding box.
 
 private:
     vec3 center;          // Circle center.
-    double radius;        // Circle radius.
+    real radius;        // Circle radius.
     vec3 normal;          // Circle normal vector.
-    Material material;    // Circle material.
+    real radiusSquared; // Baked squared radius.
+    real planeOffset;   // Baked dot product of the normal and the center.
+    AABB box;             // Baked bounding box.
+    int materialId;       // Index into the world's material table.
+    std::shared_ptr<const Texture> texture; // Shared texture of the material, null if untextured.
     bool textureIsSet;    // Texture flag.
-    double cylinderHeight; // Height of the cylinder the circle is part of.
+    real cylinderHeight; // Height of the cylinder the circle is part of.
 };
 
 #endif // CIRCLE_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "cpu_dispatch.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const Isa levels[] = { Isa::Generic, Isa::SSE42, Isa::AVX2, Isa::AVX512 }; // Every level, lowest first.
+
+// Chooses the level the kernels run at.
+/**
+ * The highest level the CPU supports, unless RT_ISA names a lower one. A level
+ * the CPU lacks, or a name that is not a level, falls back to the detected one.
+ * @return The level to run at.
+ */
+Isa chooseIsa() {
+    Isa detected = detectIsa();
+    const char* requested = std::getenv("RT_ISA");
+    if (!requested || !*requested) return detected;
+
+    for (Isa level : levels) {
+        if (std::strcmp(requested, isaName(level)) != 0) continue;
+        if (level > detected) {
+            std::cerr << "RT_ISA=" << requested << " is not supported by this CPU, using " << isaName(detected) << std::endl;
+            return detected;
+        }
+        return level;
+    }
+    std::cerr << "Unknown RT_ISA=" << requested << " (expected generic, sse4.2, avx2 or avx512), using " << isaName(detected) << std::endl;
+    return detected;
+}
+
+} // namespace
+
+// Gets the highest instruction set level this CPU and OS support.
+/**
+ * @return The level; Generic on CPU families without per-ISA kernels.
+ */
+Isa detectIsa() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512bw")) {
+        return Isa::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Isa::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return Isa::SSE42;
+    }
+#endif
+    return Isa::Generic;
+}
+
+// Gets the level the kernels run at.
+/**
+ * Chosen on first use and fixed from then on, so every kernel agrees on it.
+ * @return The level.
+ */
+Isa activeIsa() {
+    static const Isa active = chooseIsa();
+    return active;
+}
+
+// Gets the name of an instruction set level.
+/**
+ * @param isa The level.
+ * @return The name RT_ISA accepts for it.
+ */
+const char* isaName(Isa isa) {
+    switch (isa) {
+    case Isa::SSE42: return "sse4.2";
+    case Isa::AVX2: return "avx2";
+    case Isa::AVX512: return "avx512";
+    default: return "generic";
+    }
+}
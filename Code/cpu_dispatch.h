@@ -0,0 +1,60 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+/**
+ * @enum Isa
+ * @brief Instruction set levels the SIMD kernels are compiled for, lowest first.
+ */
+enum class Isa {
+    Generic, ///< Whatever the build targets, SSE2 on x86-64.
+    SSE42,   ///< SSE4.2.
+    AVX2,    ///< AVX2 and FMA.
+    AVX512   ///< AVX-512 F, VL, DQ and BW.
+};
+
+Isa detectIsa(); // Gets the highest level this CPU and OS support.
+Isa activeIsa(); // Gets the level the kernels run at, chosen once and overridable with RT_ISA.
+const char* isaName(Isa isa); // Gets the name of a level, as RT_ISA spells it.
+
+// Per-ISA code generation; empty where the compiler or CPU family has no target attribute
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RT_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define RT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define RT_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx512dq,avx512bw,avx2,fma")))
+#else
+#define RT_TARGET_SSE42
+#define RT_TARGET_AVX2
+#define RT_TARGET_AVX512
+#endif
+
+#if defined(__GNUC__)
+#define RT_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define RT_ALWAYS_INLINE inline
+#endif
+
+// Picks the variant of a kernel for the active level.
+template <typename Function>
+Function selectIsaVariant(Function generic, Function sse42, Function avx2, Function avx512) {
+    switch (activeIsa()) {
+    case Isa::AVX512: return avx512;
+    case Isa::AVX2: return avx2;
+    case Isa::SSE42: return sse42;
+    default: return generic;
+    }
+}
+
+/**
+ * Compiles the kernel name##Kernel once per level and defines name as a pointer
+ * to the variant for the active level, set during static initialisation. The
+ * kernel must be RT_ALWAYS_INLINE so every variant gets its own copy of the body,
+ * generated for that level's instructions.
+ */
+#define RT_ISA_VARIANTS(ret, name, params, args) \
+    static ret name##Generic params { return name##Kernel args; } \
+    RT_TARGET_SSE42 static ret name##Sse42 params { return name##Kernel args; } \
+    RT_TARGET_AVX2 static ret name##Avx2 params { return name##Kernel args; } \
+    RT_TARGET_AVX512 static ret name##Avx512 params { return name##Kernel args; } \
+    static ret (*const name) params = selectIsaVariant<ret (*) params>(name##Generic, name##Sse42, name##Avx2, name##Avx512);
+
+#endif // CPU_DISPATCH_H
@@ -1,159 +1,207 @@
 #include "cylinder.h"
 
-// Constructor: Initializes a cylinder with center, radius, height, and axis normal.
+// Constructor: Initializes a capped cylinder with its base center, radius, height, and axis normal.
 /**
- * @param center The center of the cylinder.
+ * @param center The center of the bottom cap.
  * @param radius The radius of the cylinder.
  * @param height The height of the cylinder.
  * @param axisNormal The normalized axis direction of the cylinder.
  */
-Cylinder::Cylinder(const vec3& center, double radius, double height, const vec3& axisNormal)
-    : center(center), radius(radius), height(height), axisNormal(const_cast<vec3&>(axisNormal).return_unit()), textureIsSet(false) {}
+Cylinder::Cylinder(const vec3& center, real radius, real height, const vec3& axisNormal)
+    : center(center), radius(radius), height(height), axisNormal(const_cast<vec3&>(axisNormal).return_unit()),
+      radiusSquared(0), invRadius(0), topOffset(0), bottomOffset(0), materialId(0), textureIsSet(false) {}
 
-// Checks for a grid-based intersection with the cylinder.
+// Moves the base center, turns the axis and scales the cylinder.
+/**
+ * @param transform The transform to apply.
+ */
+void Cylinder::transform(const Matrix4& transform) {
+    real scale = transform.scaleFactor();
+    center = transform.transformPoint(center);
+    axisNormal = transform.transformVector(axisNormal).return_unit();
+    radius *= scale;
+    height *= scale;
+    bake();
+}
+
+// Precomputes the data used by the intersection routines.
+/**
+ * The end discs of a cylinder with unit axis a extend by radius * sqrt(1 - a_i^2)
+ * along each world axis i, so the baked box is exact for any axis orientation.
+ */
+void Cylinder::bake() {
+    radiusSquared = radius * radius;
+    invRadius = 1.0 / radius;
+    top = center + height * axisNormal;
+    topOffset = vec3::dot(axisNormal, top);
+    bottomOffset = vec3::dot(-axisNormal, center);
+
+    vec3 e(radius * std::sqrt(std::max(0.0, 1.0 - axisNormal.x * axisNormal.x)),
+           radius * std::sqrt(std::max(0.0, 1.0 - axisNormal.y * axisNormal.y)),
+           radius * std::sqrt(std::max(0.0, 1.0 - axisNormal.z * axisNormal.z)));
+    box = AABB(center - e, center + e);
+    box.expand(AABB(top - e, top + e));
+}
+
+// Gets the bounding box of the cylinder.
+/**
+ * @return The baked box enclosing both end discs.
+ */
+AABB Cylinder::bounds() const {
+    return box;
+}
+
+// Finds where a ray crosses the tube between the two caps.
 /**
  * @param r The ray to test.
  * @param t_min The minimum t value for a valid hit.
  * @param t_max The maximum t value for a valid hit.
- * @param rec The record to store hit information.
- * @return True if the ray intersects the grid, false otherwise.
+ * @param t Receives the nearer valid root.
+ * @param hitHeight Receives the height of the hit along the axis.
+ * @return True if the ray crosses the tube within (t_min, t_max), false otherwise.
  */
-bool Cylinder::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    double t0 = std::numeric_limits<double>::lowest();
-    double t1 = std::numeric_limits<double>::max();
-
-    // Check if the ray intersects the bounding box of the cylinder
-    if (!hitBoundingBox(r, t0, t1))
-        return false;
+bool Cylinder::tubeRoot(const Ray& r, real t_min, real t_max, real& t, real& hitHeight) const {
+    // Project the ray onto the plane perpendicular to the axis once
+    vec3 oc = r.getOrigin() - center;
+    vec3 d_perp = r.getDirection() - axisNormal * vec3::dot(r.getDirection(), axisNormal);
+    vec3 oc_perp = oc - axisNormal * vec3::dot(oc, axisNormal);
+    real a = vec3::dot(d_perp, d_perp);
+    real b = 2 * vec3::dot(oc_perp, d_perp);
+    real c = vec3::dot(oc_perp, oc_perp) - radiusSquared;
+
+    real discriminant = b * b - 4 * a * c;
+    if (discriminant <= 0) return false;
+
+    real root = sqrt(discriminant);
+    real roots[2] = {(-b - root) / (2 * a), (-b + root) / (2 * a)};
+    for (int i = 0; i < 2; ++i) {
+        if (roots[i] < t_max && roots[i] > t_min) {
+            hitHeight = vec3::dot(r.pointAtParameter(roots[i]) - center, axisNormal);
+            if (hitHeight >= 0 && hitHeight <= height) {
+                t = roots[i];
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
-    // Ensure the intersection is within the valid range
-    t0 = std::max(t0, t_min);
-    t1 = std::min(t1, t_max);
+// Finds where a ray crosses one of the end caps.
+/**
+ * @param r The ray to test.
+ * @param capCenter The center of the cap.
+ * @param capNormal The outward normal of the cap.
+ * @param capOffset The dot product of the normal and the cap center.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param t Receives the root.
+ * @return True if the ray crosses the cap within [t_min, t_max], false otherwise.
+ */
+bool Cylinder::capRoot(const Ray& r, const vec3& capCenter, const vec3& capNormal, real capOffset,
+                       real t_min, real t_max, real& t) const {
+    real denom = vec3::dot(r.getDirection(), capNormal);
+    if (std::abs(denom) < 1e-6) return false;
 
-    // Check if the ray misses the grid
-    if (t0 >= t1)
-        return false;
+    t = (capOffset - vec3::dot(r.getOrigin(), capNormal)) / denom;
+    if (t < t_min || t > t_max) return false;
 
-    return true;
+    return (r.pointAtParameter(t) - capCenter).length_squared() <= radiusSquared;
 }
 
-// Checks for a ray-bounding box intersection.
+// Checks for a ray intersection with the tube or either cap.
 /**
+ * The tube and both caps are solved in one call, with the accelerator's test of
+ * the cylinder box as the only bound.
  * @param r The ray to test.
- * @param t0 The minimum t value for a valid hit.
- * @param t1 The maximum t value for a valid hit.
- * @return True if the ray intersects the bounding box, false otherwise.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the hit distance, the part hit (0 for the tube, 1 for the
+ * top cap, 2 for the bottom cap) and, on the tube, the height along the axis in u.
+ * @return True if the ray intersects the cylinder, false otherwise.
  */
-bool Cylinder::hitBoundingBox(const Ray& r, double& t0, double& t1) const {
-    vec3 min = (center + 0.5 * height * axisNormal) - vec3(radius, height / 2, radius);
-    vec3 max = (center + 0.5 * height * axisNormal) + vec3(radius, height / 2, radius);
-
-    double min_arr[] = {min.x, min.y, min.z};
-    double max_arr[] = {max.x, max.y, max.z};
-    vec3 ray_direction = r.getDirection();
-    double ray_direction_arr[] = {ray_direction.x, ray_direction.y, ray_direction.z};
-    vec3 ray_origin = r.getOrigin();
-    double ray_origin_arr[] = {ray_origin.x, ray_origin.y, ray_origin.z};
-
-    for (int i = 0; i < 3; ++i) {
-        double invD = 1.0 / (0.0001 + ray_direction_arr[i]);
-        double tNear = (min_arr[i] - ray_origin_arr[i]) * invD;
-        double tFar = (max_arr[i] - ray_origin_arr[i]) * invD;
-
-        if (invD < 0.0)
-            std::swap(tNear, tFar);
-
-        t0 = tNear > t0 ? tNear : t0;
-        t1 = tFar < t1 ? tFar : t1;
-
-        if (t0 >= t1)
-            return false;
+bool Cylinder::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    real closest = t_max;
+    int part = -1;
+    real t, hitHeight = 0, tubeHeight = 0;
+
+    if (tubeRoot(r, t_min, closest, t, tubeHeight)) {
+        closest = t;
+        hitHeight = tubeHeight;
+        part = 0;
+    }
+    if (capRoot(r, top, axisNormal, topOffset, t_min, closest, t)) {
+        closest = t;
+        part = 1;
+    }
+    if (capRoot(r, center, -axisNormal, bottomOffset, t_min, closest, t)) {
+        closest = t;
+        part = 2;
     }
+    if (part < 0) return false;
 
+    info.t = closest;
+    info.u = hitHeight;
+    info.prim = part;
+    info.depth = 0;
     return true;
 }
 
-// Checks for a ray-cylinder intersection.
+// Fills in the hit record for the part found by intersect.
 /**
- * @param r The ray to test.
- * @param t_min The minimum t value for a valid hit.
- * @param t_max The maximum t value for a valid hit.
+ * Each cap maps its texture like a standalone disc, and the tube wraps it around
+ * the axis.
+ * @param r The ray that hit the cylinder.
+ * @param info The hit found by intersect.
  * @param rec The record to store hit information.
- * @return True if the ray intersects the cylinder, false otherwise.
  */
-bool Cylinder::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    if (!gridHit(r, t_min, t_max, rec)) return false;
-
-    vec3 oc = r.getOrigin() - center;
-    double a = vec3::dot(r.getDirection() - axisNormal * vec3::dot(r.getDirection(), axisNormal), r.getDirection() - axisNormal * vec3::dot(r.getDirection(), axisNormal));
-    double b = 2 * vec3::dot(oc - axisNormal * vec3::dot(oc, axisNormal), r.getDirection() - axisNormal * vec3::dot(r.getDirection(), axisNormal));
-    double c = vec3::dot(oc - axisNormal * vec3::dot(oc, axisNormal), oc - axisNormal * vec3::dot(oc, axisNormal)) - radius * radius;
-
-    double discriminant = b * b - 4 * a * c;
-
-    if (discriminant > 0) {
-        double root1 = (-b - sqrt(discriminant)) / (2 * a);
-        double root2 = (-b + sqrt(discriminant)) / (2 * a);
-
-        if (root1 < t_max && root1 > t_min) {
-            double hit_height = vec3::dot(r.pointAtParameter(root1) - center, axisNormal);
-
-            if (hit_height >= 0 && hit_height <= height) {
-                rec.material = this->material;
-                rec.t = root1;
-                rec.p = r.pointAtParameter(rec.t);
-                rec.normal = (rec.p - center - hit_height * axisNormal).return_unit();
-
-                if (textureIsSet) {
-                    double phi = atan2(rec.normal.z, rec.normal.x);
-                    if (phi < 0) phi += 2 * 3.14;
-                    double u = phi / (2 * 3.14);
-                    double v = hit_height / height;
-                    rec.material.setDiffuseColor(material.getTexture(u, v));
-                }
-                rec.normal.return_unit();
-                return true;
-            }
+void Cylinder::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    rec.materialId = materialId;
+    rec.textured = textureIsSet;
+    rec.t = info.t;
+    rec.p = r.pointAtParameter(info.t);
+
+    if (info.prim == 0) {
+        real hitHeight = info.u;
+        rec.normal = (rec.p - center - hitHeight * axisNormal) * invRadius;
+        if (textureIsSet) {
+            real phi = atan2(rec.normal.z, rec.normal.x);
+            if (phi < 0) phi += 2 * 3.14;
+            real u = phi / (2 * 3.14);
+            real v = hitHeight / height;
+            rec.textureColor = texture->getColor(u, v);
         }
-
-        if (root2 < t_max && root2 > t_min) {
-            double hit_height = vec3::dot(r.pointAtParameter(root2) - center, axisNormal);
-
-            if (hit_height >= 0 && hit_height <= height) {
-                rec.material = this->material;
-                rec.t = root2;
-                rec.p = r.pointAtParameter(rec.t);
-                rec.normal = (rec.p - center - hit_height * axisNormal).return_unit();
-
-                if (textureIsSet) {
-                    double phi = atan2(rec.normal.z, rec.normal.x);
-                    if (phi < 0) phi += 2 * 3.14;
-                    double u = phi / (2 * 3.14);
-                    double v = hit_height / height;
-                    rec.material.setDiffuseColor(material.getTexture(u, v));
-                }
-                rec.normal.return_unit();
-                return true;
-            }
+    } else {
+        rec.normal = info.prim == 1 ? axisNormal : -axisNormal;
+        if (textureIsSet) {
+            real u = 0.5 + atan2(rec.normal.z, rec.normal.x) / (2 * 3.14);
+            real v = 0.5 - asin(rec.normal.y) / 3.14;
+            rec.textureColor = texture->getColor(u, v);
         }
     }
-
-    return false;
 }
 
-// Sets the material of the cylinder.
+// Checks if the tube or either cap blocks a ray segment.
 /**
- * @param material The material to set.
+ * Only solves for the roots; no normal or texture is computed.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True if the ray crosses the cylinder within [t_min, t_max], false otherwise.
  */
-void Cylinder::setMaterial(Material material) {
-    this->material = material;
+bool Cylinder::occludes(const Ray& r, real t_min, real t_max) const {
+    real t, hitHeight;
+    return tubeRoot(r, t_min, t_max, t, hitHeight)
+        || capRoot(r, top, axisNormal, topOffset, t_min, t_max, t)
+        || capRoot(r, center, -axisNormal, bottomOffset, t_min, t_max, t);
 }
 
-// Sets the texture of the cylinder.
+// Sets the material of the cylinder.
 /**
- * @param texturePath The file path to the texture.
+ * @param materialId The index of the material in the world's material table.
+ * @param material The material itself, used to pick up its shared texture.
  */
-void Cylinder::setTexture(const std::string& texturePath) {
-    this->material.setTexture(texturePath);
-    this->textureIsSet = true;
+void Cylinder::setMaterial(int materialId, const Material& material) {
+    this->materialId = materialId;
+    this->texture = material.getTextureHandle();
+    this->textureIsSet = material.hasTexture();
 }
\ No newline at end of file
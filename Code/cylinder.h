@@ -6,25 +6,38 @@
 
 /**
  * @class Cylinder
- * @brief Represents a cylinder that can be hit by rays.
+ * @brief Represents a closed cylinder, tube and both end caps, that can be hit by rays.
  */
-class Cylinder : public Hittable {
+class Cylinder final : public Hittable {
 public:
-    Cylinder() : textureIsSet(false) {} // Default constructor.
-    Cylinder(const vec3& center, double radius, double height, const vec3& axisNormal); // Constructor.
+    Cylinder() : radius(0), height(0), radiusSquared(0), invRadius(0), topOffset(0), bottomOffset(0), materialId(0), textureIsSet(false) {} // Default constructor.
+    Cylinder(const vec3& center, real radius, real height, const vec3& axisNormal); // Constructor.
 
-    void setMaterial(Material material); // Sets the cylinder's material.
-    void setTexture(const std::string& texturePath); // Sets the cylinder's texture.
-    bool gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const; // Grid-based intersection check.
-    bool hitBoundingBox(const Ray& r, double& t0, double& t1) const; // Checks for ray-bounding box intersection.
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override; // Checks for ray-cylinder intersection.
+    void setMaterial(int materialId, const Material& material); // Sets the cylinder's material from the world's material table.
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Checks for ray intersection with the tube or either cap.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record for the part that was hit.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if the cylinder blocks a ray segment.
+    virtual void transform(const Matrix4& transform) override; // Moves the base center and turns the axis.
+    virtual void bake() override; // Precomputes the squared and reciprocal radius and the bounding box.
+    virtual AABB bounds() const override; // Gets the cylinder's bounding box.
 
 private:
-    vec3 center;          // Cylinder center.
-    double radius;        // Cylinder radius.
-    double height;        // Cylinder height.
+    bool tubeRoot(const Ray& r, real t_min, real t_max, real& t, real& hitHeight) const; // Finds where a ray crosses the tube.
+    bool capRoot(const Ray& r, const vec3& capCenter, const vec3& capNormal, real capOffset,
+                 real t_min, real t_max, real& t) const; // Finds where a ray crosses an end cap.
+
+    vec3 center;          // Center of the bottom cap.
+    real radius;        // Cylinder radius.
+    real height;        // Cylinder height.
     vec3 axisNormal;      // Cylinder axis normal.
-    Material material;    // Cylinder material.
+    real radiusSquared; // Baked squared radius.
+    real invRadius;     // Baked reciprocal radius.
+    vec3 top;             // Baked center of the top cap.
+    real topOffset;     // Baked dot product of the axis and the top center.
+    real bottomOffset;  // Baked dot product of the reversed axis and the bottom center.
+    AABB box;             // Baked bounding box.
+    int materialId;       // Index into the world's material table.
+    std::shared_ptr<const Texture> texture; // Shared texture of the material, null if untextured.
     bool textureIsSet;    // Texture flag.
 };
 
@@ -0,0 +1,85 @@
+#include "framebuffer.h"
+#include "color.h"
+#include <fstream>
+#include <algorithm>
+
+// Constructor: creates a black image of the given size.
+/**
+ * @param width The image width in pixels.
+ * @param height The image height in pixels.
+ */
+Framebuffer::Framebuffer(int width, int height) : width(0), height(0) {
+    resize(width, height);
+}
+
+// Resizes the image and clears it to black.
+/**
+ * @param width The image width in pixels.
+ * @param height The image height in pixels.
+ */
+void Framebuffer::resize(int width, int height) {
+    this->width = width;
+    this->height = height;
+    pixels.assign(size_t(width) * size_t(height), Pixel());
+}
+
+// Stores the color of a pixel.
+/**
+ * Negative components are clamped to zero, matching what the PPM writer outputs.
+ * @param x The horizontal pixel index.
+ * @param y The vertical pixel index, 0 at the top.
+ * @param color The linear RGB color.
+ */
+void Framebuffer::setPixel(int x, int y, const vec3& color) {
+    Pixel& pixel = pixels[size_t(y) * width + x];
+    pixel.r = float(std::max<real>(0, color.x));
+    pixel.g = float(std::max<real>(0, color.y));
+    pixel.b = float(std::max<real>(0, color.z));
+}
+
+// Gets the color of a pixel.
+/**
+ * @param x The horizontal pixel index.
+ * @param y The vertical pixel index, 0 at the top.
+ * @return The linear RGB color.
+ */
+vec3 Framebuffer::getPixel(int x, int y) const {
+    const Pixel& pixel = pixels[size_t(y) * width + x];
+    return vec3(pixel.r, pixel.g, pixel.b);
+}
+
+// Gets the image width.
+/**
+ * @return The width in pixels.
+ */
+int Framebuffer::getWidth() const {
+    return width;
+}
+
+// Gets the image height.
+/**
+ * @return The height in pixels.
+ */
+int Framebuffer::getHeight() const {
+    return height;
+}
+
+// Gets the row-major pixel data.
+/**
+ * @return The pixels, top row first.
+ */
+const std::vector<Pixel>& Framebuffer::getPixels() const {
+    return pixels;
+}
+
+// Writes the image as an ASCII PPM file.
+/**
+ * @param filename The output file path.
+ */
+void Framebuffer::writePPM(const std::string& filename) const {
+    std::ofstream outFile(filename);
+    outFile << "P3\n" << width << ' ' << height << "\n255\n";
+    for (const auto& pixel : pixels) {
+        paintPixel(vec3(pixel.r, pixel.g, pixel.b), outFile);
+    }
+}
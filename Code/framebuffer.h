@@ -0,0 +1,37 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <vector>
+#include <string>
+#include "vector.h"
+#include "tonemapping.h"
+
+/**
+ * @class Framebuffer
+ * @brief In-memory HDR image that render threads write into directly.
+ *
+ * Pixels are stored as linear float RGB, so the image can be written out or
+ * tone-mapped without going through an intermediate text file. Workers write
+ * disjoint pixels, so no locking is needed.
+ */
+class Framebuffer {
+public:
+    Framebuffer() : width(0), height(0) {} // Default constructor.
+    Framebuffer(int width, int height); // Constructor, creates a black image.
+
+    void resize(int width, int height); // Resizes and clears the image.
+    void setPixel(int x, int y, const vec3& color); // Stores the color of a pixel.
+    vec3 getPixel(int x, int y) const; // Gets the color of a pixel.
+    int getWidth() const; // Gets the image width.
+    int getHeight() const; // Gets the image height.
+    const std::vector<Pixel>& getPixels() const; // Gets the row-major pixel data.
+
+    void writePPM(const std::string& filename) const; // Writes the image as an ASCII PPM.
+
+private:
+    int width;                 // Image width in pixels.
+    int height;                // Image height in pixels.
+    std::vector<Pixel> pixels; // Row-major float RGB pixels.
+};
+
+#endif // FRAMEBUFFER_H
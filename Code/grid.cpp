@@ -0,0 +1,305 @@
+#include "grid.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+/**
+ * @struct Mailbox
+ * @brief Records, per render thread, which ray last tested each object of a grid.
+ */
+struct Mailbox {
+    unsigned buildId = 0;          ///< Grid build the entries belong to.
+    unsigned rayId = 0;            ///< Id of the current ray.
+    std::vector<unsigned> lastRay; ///< Id of the ray that last tested each object.
+};
+
+thread_local Mailbox mailbox; // Each render thread has its own mailbox.
+
+std::atomic<unsigned> nextBuildId(1); // Source of grid build ids.
+
+// Starts a new ray in the calling thread's mailbox.
+/**
+ * @param buildId The id of the grid being walked.
+ * @param objectCount The number of objects in that grid.
+ * @return The id to stamp objects with while walking this ray.
+ */
+unsigned beginRay(unsigned buildId, size_t objectCount) {
+    if (mailbox.buildId != buildId || mailbox.lastRay.size() != objectCount) {
+        mailbox.buildId = buildId;
+        mailbox.rayId = 0;
+        mailbox.lastRay.assign(objectCount, 0);
+    }
+    if (++mailbox.rayId == 0) {
+        // The counter wrapped, so old stamps could collide with new ids
+        std::fill(mailbox.lastRay.begin(), mailbox.lastRay.end(), 0);
+        mailbox.rayId = 1;
+    }
+    return mailbox.rayId;
+}
+
+} // namespace
+
+// Default constructor: Creates an empty grid.
+GridAccelerator::GridAccelerator() : buildId(0) {
+    resolution[0] = resolution[1] = resolution[2] = 0;
+}
+
+// Flattens cell coordinates into a cell index.
+/**
+ * @param x The cell coordinate along x.
+ * @param y The cell coordinate along y.
+ * @param z The cell coordinate along z.
+ * @return The index of the cell.
+ */
+int GridAccelerator::cellIndex(int x, int y, int z) const {
+    return (z * resolution[1] + y) * resolution[0] + x;
+}
+
+// Gets the cell coordinate of a position along one axis.
+/**
+ * @param position The position along the axis.
+ * @param axis The axis (0 = x, 1 = y, 2 = z).
+ * @return The cell coordinate, clamped to the grid.
+ */
+int GridAccelerator::cellCoordinate(real position, int axis) const {
+    int cell = int((position - box.min[axis]) * invCellSize[axis]);
+    return std::max(0, std::min(cell, resolution[axis] - 1));
+}
+
+// Bins the objects into the grid cells.
+/**
+ * The resolution follows the usual density heuristic: about four objects per cell
+ * on average, with cells as close to cubes as the scene extent allows.
+ * @param objects The objects to index.
+ */
+void GridAccelerator::build(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    const double objectsPerCell = 4.0;
+
+    prims.build(objects);
+    buildId = nextBuildId++;
+    cellStart.clear();
+    cellObjects.clear();
+    largeObjects.clear();
+
+    std::vector<AABB> objectBounds;
+    objectBounds.reserve(objects.size());
+    AABB sceneBox;
+    for (const auto& object : objects) {
+        objectBounds.push_back(object->bounds());
+        sceneBox.expand(objectBounds.back());
+    }
+
+    // Set aside objects that dominate the scene extent; the grid covers the rest
+    vec3 sceneExtent = sceneBox.extent();
+    size_t gridObjectCount = 0;
+    box = AABB();
+    for (size_t object = 0; object < objectBounds.size(); ++object) {
+        AABB& bounds = objectBounds[object];
+        if (bounds.isEmpty()) continue;
+
+        vec3 extent = bounds.extent();
+        if (objects.size() > 1 && (extent.x > 0.5 * sceneExtent.x || extent.y > 0.5 * sceneExtent.y || extent.z > 0.5 * sceneExtent.z)) {
+            largeObjects.push_back(int(object));
+            bounds = AABB();
+            continue;
+        }
+        box.expand(bounds);
+        ++gridObjectCount;
+    }
+    if (box.isEmpty()) return;
+
+    // Pad the box so flat scenes still have cells of non-zero size
+    vec3 extent = box.extent();
+    double pad = 1e-6 * std::max(extent.x, std::max(extent.y, extent.z)) + 1e-9;
+    box = AABB(box.min - vec3(pad, pad, pad), box.max + vec3(pad, pad, pad));
+    extent = box.extent();
+
+    double cellsPerUnit = std::cbrt(gridObjectCount / objectsPerCell / (extent.x * extent.y * extent.z));
+    for (int axis = 0; axis < 3; ++axis) {
+        double cells = std::round(extent[axis] * cellsPerUnit);
+        resolution[axis] = int(std::max(1.0, std::min(double(maxResolution), cells)));
+    }
+    cellSize = vec3(extent.x / resolution[0], extent.y / resolution[1], extent.z / resolution[2]);
+    invCellSize = vec3(1.0 / cellSize.x, 1.0 / cellSize.y, 1.0 / cellSize.z);
+
+    // Count the objects per cell, then fill the packed lists in a second pass
+    int cellCount = resolution[0] * resolution[1] * resolution[2];
+    cellStart.assign(cellCount + 1, 0);
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<int> fill;
+        if (pass == 1) {
+            for (int cell = 0; cell < cellCount; ++cell)
+                cellStart[cell + 1] += cellStart[cell];
+            cellObjects.resize(cellStart[cellCount]);
+            fill.assign(cellStart.begin(), cellStart.end() - 1);
+        }
+
+        for (size_t object = 0; object < objectBounds.size(); ++object) {
+            const AABB& bounds = objectBounds[object];
+            if (bounds.isEmpty()) continue;
+
+            int lo[3], hi[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                lo[axis] = cellCoordinate(bounds.min[axis], axis);
+                hi[axis] = cellCoordinate(bounds.max[axis], axis);
+            }
+            for (int z = lo[2]; z <= hi[2]; ++z) {
+                for (int y = lo[1]; y <= hi[1]; ++y) {
+                    for (int x = lo[0]; x <= hi[0]; ++x) {
+                        int cell = cellIndex(x, y, z);
+                        if (pass == 0) {
+                            ++cellStart[cell + 1];
+                        } else {
+                            cellObjects[fill[cell]++] = int(object);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Walks the cells a ray segment crosses, front to back.
+/**
+ * @param r The ray to walk.
+ * @param t_min The minimum t value of the segment.
+ * @param t_max The maximum t value of the segment.
+ * @param visitCell Callable bool(int cell, real tExit) that tests the objects of a
+ *                  cell, where tExit is where the ray leaves it; returns true to stop.
+ */
+template <typename VisitCell>
+void GridAccelerator::walk(const Ray& r, real t_min, real t_max, VisitCell visitCell) const {
+    if (cellStart.empty()) return;
+
+    vec3 origin = r.getOrigin();
+    vec3 direction = r.getDirection();
+    vec3 invDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+    // Clip the segment to the grid box
+    real tEnter = t_min;
+    real tLeave = t_max;
+    for (int axis = 0; axis < 3; ++axis) {
+        real tNear = (box.min[axis] - origin[axis]) * invDirection[axis];
+        real tFar = (box.max[axis] - origin[axis]) * invDirection[axis];
+        if (tNear > tFar) std::swap(tNear, tFar);
+        tEnter = std::max(tEnter, tNear);
+        tLeave = std::min(tLeave, tFar);
+        if (tEnter > tLeave) return;
+    }
+
+    // Set up the DDA: the next boundary crossing and the spacing of crossings per axis
+    int cell[3], step[3];
+    real tNext[3], tDelta[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        cell[axis] = cellCoordinate(origin[axis] + tEnter * direction[axis], axis);
+        if (direction[axis] > 0) {
+            step[axis] = 1;
+            tNext[axis] = (box.min[axis] + (cell[axis] + 1) * cellSize[axis] - origin[axis]) * invDirection[axis];
+            tDelta[axis] = cellSize[axis] * invDirection[axis];
+        } else if (direction[axis] < 0) {
+            step[axis] = -1;
+            tNext[axis] = (box.min[axis] + cell[axis] * cellSize[axis] - origin[axis]) * invDirection[axis];
+            tDelta[axis] = -cellSize[axis] * invDirection[axis];
+        } else {
+            step[axis] = 0;
+            tNext[axis] = std::numeric_limits<real>::infinity();
+            tDelta[axis] = std::numeric_limits<real>::infinity();
+        }
+    }
+
+    while (true) {
+        int axis = tNext[0] < tNext[1] ? (tNext[0] < tNext[2] ? 0 : 2) : (tNext[1] < tNext[2] ? 1 : 2);
+        real tExit = std::min(tNext[axis], tLeave);
+
+        if (visitCell(cellIndex(cell[0], cell[1], cell[2]), tExit)) return;
+        if (tNext[axis] >= tLeave) return;
+
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= resolution[axis]) return;
+        tNext[axis] += tDelta[axis];
+    }
+}
+
+// Finds the closest intersection by walking the grid.
+/**
+ * Objects spanning several cells may be hit beyond the current cell, so the walk
+ * only stops once the closest hit so far lies within the cell just visited.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param rec The record to store hit information.
+ * @return True if the ray hits an object, false otherwise.
+ */
+bool GridAccelerator::hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    unsigned ray = beginRay(buildId, prims.size());
+    std::vector<unsigned>& lastRay = mailbox.lastRay;
+
+    HitInfo info;
+    int closest = -1;
+    real closest_so_far = t_max;
+
+    for (int object : largeObjects) {
+        if (prims.intersect(object, r, t_min, closest_so_far, info)) {
+            closest = object;
+            closest_so_far = info.t;
+        }
+    }
+
+    walk(r, t_min, closest_so_far, [&](int cell, real tExit) {
+        for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            int object = cellObjects[i];
+            if (lastRay[object] == ray) continue;
+            lastRay[object] = ray;
+
+            if (prims.intersect(object, r, t_min, closest_so_far, info)) {
+                closest = object;
+                closest_so_far = info.t;
+            }
+        }
+        return closest >= 0 && closest_so_far <= tExit;
+    });
+    if (closest < 0) return false;
+
+    prims.surface(closest, r, info, rec);
+    return true;
+}
+
+// Checks if any object blocks a ray segment by walking the grid.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param blocker If not null, receives the object that blocked the ray.
+ * @return True as soon as one object blocks the segment, false otherwise.
+ */
+bool GridAccelerator::occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker) const {
+    for (int object : largeObjects) {
+        if (prims.occludes(object, r, t_min, t_max)) {
+            if (blocker) *blocker = prims.get(object);
+            return true;
+        }
+    }
+
+    unsigned ray = beginRay(buildId, prims.size());
+    std::vector<unsigned>& lastRay = mailbox.lastRay;
+
+    bool blocked = false;
+    walk(r, t_min, t_max, [&](int cell, real) {
+        for (int i = cellStart[cell]; i < cellStart[cell + 1]; ++i) {
+            int object = cellObjects[i];
+            if (lastRay[object] == ray) continue;
+            lastRay[object] = ray;
+
+            if (prims.occludes(object, r, t_min, t_max)) {
+                if (blocker) *blocker = prims.get(object);
+                blocked = true;
+                return true;
+            }
+        }
+        return false;
+    });
+    return blocked;
+}
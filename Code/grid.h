@@ -0,0 +1,55 @@
+#ifndef GRID_H
+#define GRID_H
+
+#include <vector>
+#include <memory>
+#include "aabb.h"
+#include "accelerator.h"
+
+/**
+ * @class GridAccelerator
+ * @brief Uniform 3D grid over the world's objects, walked with a 3D-DDA.
+ *
+ * Every cell lists the objects whose boxes overlap it; the lists are packed into
+ * one index array. Rays step from cell to cell in order (Amanatides and Woo), and a
+ * per-thread mailbox makes sure an object spanning several cells is tested only
+ * once per ray. Suited to dense, evenly spread scenes where a hierarchy buys little.
+ *
+ * Objects spanning more than half the scene along some axis, such as a floor, would
+ * stretch the grid and land in most cells, so they are kept aside and tested directly.
+ */
+class GridAccelerator : public Accelerator {
+public:
+    GridAccelerator(); // Default constructor.
+
+    virtual void build(const std::vector<std::shared_ptr<Hittable>>& objects) override; // Bins the objects into cells.
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const override; // Closest-hit query.
+    virtual bool occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker = nullptr) const override; // Any-hit query.
+    virtual std::string name() const override { return "grid"; }
+
+    static const int maxResolution = 128; // Upper bound on cells along one axis.
+
+private:
+    /**
+     * @brief Walks the cells a ray segment crosses, front to back.
+     * @param visitCell Callable bool(int cell, real tExit) that tests the cell's
+     *                  objects and returns true to stop the walk.
+     */
+    template <typename VisitCell>
+    void walk(const Ray& r, real t_min, real t_max, VisitCell visitCell) const;
+
+    int cellIndex(int x, int y, int z) const; // Flattens cell coordinates.
+    int cellCoordinate(real position, int axis) const; // Gets the clamped cell coordinate of a position.
+
+    PrimitiveArrays prims; // Copies of the objects indexed by the grid.
+    std::vector<int> largeObjects; // Objects too large for the grid, tested for every ray.
+    AABB box;               // Bounds of the grid.
+    int resolution[3];      // Number of cells along each axis.
+    vec3 cellSize;          // Size of one cell.
+    vec3 invCellSize;       // Reciprocal cell size.
+    std::vector<int> cellStart;   // Offset of each cell's list in cellObjects, plus a final end offset.
+    std::vector<int> cellObjects; // Object indices of all cells, packed.
+    unsigned buildId;       // Unique id of this build, keys the per-thread mailboxes.
+};
+
+#endif // GRID_H
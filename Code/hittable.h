@@ -4,16 +4,38 @@
 #include "Ray.h"
 #include "vector.h"
 #include "Material.h"
+#include "aabb.h"
+#include "matrix4.h"
+#include "ray_packet.h"
 
 /**
  * @struct HitRecord
  * @brief Stores information about a ray-object intersection.
  */
 struct HitRecord {
-    double t;       ///< The parameter t at which the ray intersects the object.
+    real t;       ///< The parameter t at which the ray intersects the object.
     vec3 p;         ///< The intersection point.
     vec3 normal;    ///< The surface normal at the intersection point.
-    Material material; ///< The material of the intersected object.
+    int materialId;    ///< Index of the object's material in the world's material table.
+    bool textured;     ///< True if textureColor holds the textured diffuse color.
+    vec3 textureColor; ///< Diffuse color looked up from the object's texture at the hit point.
+};
+
+/**
+ * @struct HitInfo
+ * @brief The bare result of an intersection test, from which the hit record is filled in later.
+ *
+ * Closest-hit searches keep only this for each candidate and evaluate the point,
+ * normal and texture once, for the hit that wins.
+ */
+struct HitInfo {
+    static const int maxNesting = 16; ///< Deepest chain of geometry groups a hit can pass through.
+
+    real t;    ///< The parameter t at which the ray intersects the object.
+    real u, v; ///< Barycentric or local surface coordinates, as the primitive defines them.
+    int prim;    ///< Part of the primitive that was hit, as the primitive defines it.
+    int depth;   ///< Number of entries in path.
+    int path[maxNesting]; ///< Child hit in each geometry group on the way down, innermost first.
 };
 
 /**
@@ -30,7 +52,99 @@ public:
      * @param rec The record to store hit information.
      * @return True if the ray hits the object, false otherwise.
      */
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const = 0;
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+        HitInfo info;
+        if (!intersect(r, t_min, t_max, info)) return false;
+        surface(r, info, rec);
+        return true;
+    }
+
+    /**
+     * @brief Finds where a ray hits the object, without computing hit attributes.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param info Receives the distance and whatever surface needs to finish the hit.
+     * @return True if the ray hits the object, false otherwise.
+     */
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const = 0;
+
+    /**
+     * @brief Fills in the hit record for a hit found by intersect.
+     * @param r The ray passed to intersect.
+     * @param info The result of intersect.
+     * @param rec The record to store hit information.
+     */
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const = 0;
+
+    /**
+     * @brief Checks if the object blocks a ray segment, without computing hit attributes.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @return True if the ray hits the object within [t_min, t_max], false otherwise.
+     */
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const {
+        HitInfo info;
+        return intersect(r, t_min, t_max, info);
+    }
+
+    /**
+     * @brief Finds where the active rays of a packet in mask hit the object.
+     * The default tests the rays one by one; shapes with a SIMD test override it.
+     * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+     * @param mask The lanes to test.
+     * @param info Receives the hit of each lane that hits, indexed by lane.
+     * @return The bit mask of lanes that hit the object.
+     */
+    virtual int intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const {
+        int hits = 0;
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if ((mask & (1 << lane)) && intersect(packet.ray(lane), packet.tMin, packet.tMax[lane], info[lane])) {
+                packet.tMax[lane] = info[lane].t;
+                hits |= 1 << lane;
+            }
+        }
+        return hits;
+    }
+
+    /**
+     * @brief Checks which active rays of a packet in mask the object blocks.
+     * @param packet The rays, each with its own range.
+     * @param mask The lanes to test.
+     * @return The bit mask of lanes the object blocks.
+     */
+    virtual int occludesPacket(const RayPacket& packet, int mask) const {
+        int blocked = 0;
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if ((mask & (1 << lane)) && occludes(packet.ray(lane), packet.tMin, packet.tMax[lane])) {
+                blocked |= 1 << lane;
+            }
+        }
+        return blocked;
+    }
+
+    /**
+     * @brief Moves the object in place and re-bakes it.
+     * Analytic shapes keep their shape, so they follow the rotation, translation and
+     * uniform scale part of the transform; vertex-based shapes follow it exactly.
+     * @param transform The transform to apply on top of the current placement.
+     */
+    virtual void transform(const Matrix4& transform) = 0;
+
+    /**
+     * @brief Precomputes the data the intersection routines need.
+     * Called once after the scene is loaded, before any ray is traced.
+     */
+    virtual void bake() {}
+
+    /**
+     * @brief Gets a world-space box enclosing the object.
+     * @return The bounding box of the object, exact once the object is baked.
+     */
+    virtual AABB bounds() const = 0;
+
+    virtual ~Hittable() {}
 };
 
 #endif // HITTABLE_H
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include "instance.h"
+#include <algorithm>
+
+// Adds a shape to the group.
+/**
+ * @param object The shape, given in the group's object space.
+ */
+void GeometryGroup::add(std::shared_ptr<Hittable> object) {
+    objects.push_back(object);
+
+    const Instance* instance = dynamic_cast<const Instance*>(object.get());
+    if (instance) {
+        nesting = std::max(nesting, instance->getGeometry()->getNesting() + 1);
+    }
+}
+
+// Gets the number of shapes in the group.
+/**
+ * @return The number of shapes.
+ */
+size_t GeometryGroup::size() const {
+    return objects.size();
+}
+
+// Gets how many groups deep the group's shapes go.
+/**
+ * @return 1 for a group of plain shapes, one more than the deepest group it
+ * instances otherwise.
+ */
+int GeometryGroup::getNesting() const {
+    return nesting;
+}
+
+// Bakes the shapes and builds the group's BVH.
+void GeometryGroup::bake() {
+    std::vector<AABB> objectBounds;
+    objectBounds.reserve(objects.size());
+    box = AABB();
+    for (const auto& object : objects) {
+        object->bake();
+        objectBounds.push_back(object->bounds());
+        box.expand(objectBounds.back());
+    }
+    bvh.build(objectBounds);
+}
+
+// Moves every shape of the group.
+/**
+ * The group is shared, so this moves every instance of it as well.
+ * @param transform The transform to apply.
+ */
+void GeometryGroup::transform(const Matrix4& transform) {
+    for (const auto& object : objects) {
+        object->transform(transform);
+    }
+    bake();
+}
+
+// Gets the group's bounding box.
+/**
+ * @return The baked object-space box of all shapes.
+ */
+AABB GeometryGroup::bounds() const {
+    return box;
+}
+
+// Finds the closest hit over the group's shapes.
+/**
+ * @param r The ray to test, in object space.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the shape's hit, with the shape's index appended to the path.
+ * @return True if the ray hits a shape of the group, false otherwise.
+ */
+bool GeometryGroup::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    return bvh.closestHit(r, t_min, t_max, [&](int prim, real tMin, real& tMax) {
+        if (objects[prim]->intersect(r, tMin, tMax, info)) {
+            info.path[info.depth++] = prim;
+            tMax = info.t;
+            return true;
+        }
+        return false;
+    });
+}
+
+// Fills in the hit record through the shape at the end of the path.
+/**
+ * @param r The ray that hit the group, in object space.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void GeometryGroup::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    HitInfo shapeInfo = info;
+    --shapeInfo.depth;
+    objects[info.path[shapeInfo.depth]]->surface(r, shapeInfo, rec);
+}
+
+// Checks if any shape of the group blocks a ray segment.
+/**
+ * @param r The ray to test, in object space.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True as soon as one shape blocks the segment, false otherwise.
+ */
+bool GeometryGroup::occludes(const Ray& r, real t_min, real t_max) const {
+    return bvh.anyHit(r, t_min, t_max, [&](int prim) {
+        return objects[prim]->occludes(r, t_min, t_max);
+    });
+}
+
+// Constructor: Places a geometry group with a transform.
+/**
+ * @param geometry The shared geometry group, baked before instances are baked.
+ * @param objectToWorld The transform from the group's object space to world space.
+ */
+Instance::Instance(std::shared_ptr<const GeometryGroup> geometry, const Matrix4& objectToWorld)
+    : geometry(geometry) {
+    setTransform(objectToWorld);
+}
+
+// Moves the instance.
+/**
+ * Only the instance's own matrices and box change; the shared geometry and its
+ * BVH are untouched, so the caller only has to update the world's top level.
+ * @param objectToWorld The new transform from object space to world space.
+ */
+void Instance::setTransform(const Matrix4& objectToWorld) {
+    this->objectToWorld = objectToWorld;
+    worldToObject = objectToWorld.inverse();
+    normalToWorld = worldToObject.transpose();
+    bake();
+}
+
+// Applies a transform on top of the current placement.
+/**
+ * @param transform The transform to apply.
+ */
+void Instance::transform(const Matrix4& transform) {
+    setTransform(transform * objectToWorld);
+}
+
+// Gets the placed geometry group.
+/**
+ * @return The shared geometry group.
+ */
+std::shared_ptr<const GeometryGroup> Instance::getGeometry() const {
+    return geometry;
+}
+
+// Gets the object-to-world transform.
+/**
+ * @return The transform placing the geometry in the world.
+ */
+const Matrix4& Instance::getTransform() const {
+    return objectToWorld;
+}
+
+// Computes the world-space bounding box.
+/**
+ * Transforms the eight corners of the group's box, which encloses the placed
+ * geometry for any affine transform.
+ */
+void Instance::bake() {
+    box = AABB();
+    AABB local = geometry->bounds();
+    if (local.isEmpty()) return;
+
+    for (int corner = 0; corner < 8; ++corner) {
+        vec3 p((corner & 1) ? local.max.x : local.min.x,
+               (corner & 2) ? local.max.y : local.min.y,
+               (corner & 4) ? local.max.z : local.min.z);
+        box.expand(objectToWorld.transformPoint(p));
+    }
+}
+
+// Gets the instance's world-space bounding box.
+/**
+ * @return The box enclosing the transformed geometry.
+ */
+AABB Instance::bounds() const {
+    return box;
+}
+
+// Moves a world-space ray into object space.
+/**
+ * @param r The world-space ray.
+ * @return The object-space ray with the same parameterization.
+ */
+Ray Instance::toObjectSpace(const Ray& r) const {
+    return Ray(worldToObject.transformPoint(r.getOrigin()),
+               worldToObject.transformVector(r.getDirection()),
+               r.getColor(), r.getDepth());
+}
+
+// Checks for a hit on the placed geometry.
+/**
+ * Hit distances are the same in both spaces, so nothing has to be moved back
+ * until the hit record is filled in.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the hit found in the geometry group.
+ * @return True if the ray hits the placed geometry, false otherwise.
+ */
+bool Instance::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    return geometry->intersect(toObjectSpace(r), t_min, t_max, info);
+}
+
+// Fills in the hit record in world space.
+/**
+ * @param r The ray that hit the instance.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information, in world space.
+ */
+void Instance::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    geometry->surface(toObjectSpace(r), info, rec);
+
+    rec.p = r.pointAtParameter(rec.t);
+    rec.normal = normalToWorld.transformVector(rec.normal).return_unit();
+}
+
+// Checks if the placed geometry blocks a ray segment.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True if the placed geometry blocks the segment, false otherwise.
+ */
+bool Instance::occludes(const Ray& r, real t_min, real t_max) const {
+    return geometry->occludes(toObjectSpace(r), t_min, t_max);
+}
@@ -0,0 +1,73 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <vector>
+#include <memory>
+#include "hittable.h"
+#include "wide_bvh.h"
+#include "matrix4.h"
+
+/**
+ * @class GeometryGroup
+ * @brief Named set of shapes with its own BVH, shared by every instance placing it.
+ *
+ * The group is the bottom level of a two-level structure: it is baked once,
+ * in its own object space, no matter how many instances refer to it.
+ */
+class GeometryGroup : public Hittable {
+public:
+    GeometryGroup() : nesting(1) {} // Default constructor.
+
+    void add(std::shared_ptr<Hittable> object); // Adds a shape to the group.
+    size_t size() const; // Gets the number of shapes in the group.
+    int getNesting() const; // Gets how many groups deep the group's shapes go, at most HitInfo::maxNesting to be hit.
+
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Closest hit over the group.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record through the shape hit.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Any hit over the group.
+    virtual void transform(const Matrix4& transform) override; // Moves every shape of the group, and so every instance of it.
+    virtual void bake() override; // Bakes the shapes and builds the group's BVH.
+    virtual AABB bounds() const override; // Gets the group's object-space bounding box.
+
+private:
+    std::vector<std::shared_ptr<Hittable>> objects; // Shapes in object space.
+    WideBVH bvh;                                    // Hierarchy over the shapes.
+    AABB box;                                       // Baked bounding box.
+    int nesting;                                    // Levels of groups down to the deepest shape.
+};
+
+/**
+ * @class Instance
+ * @brief Places a shared geometry group in the world with a 4x4 transform.
+ *
+ * Rays are moved into the group's object space rather than copying the geometry,
+ * so memory grows with the number of unique groups, not with the number of instances.
+ * The direction is transformed without normalizing, so hit distances are the same
+ * in both spaces.
+ */
+class Instance : public Hittable {
+public:
+    Instance(std::shared_ptr<const GeometryGroup> geometry, const Matrix4& objectToWorld); // Constructor.
+
+    void setTransform(const Matrix4& objectToWorld); // Moves the instance; the world's top level must be updated afterwards.
+    const Matrix4& getTransform() const; // Gets the object-to-world transform.
+    std::shared_ptr<const GeometryGroup> getGeometry() const; // Gets the placed geometry group.
+
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Checks for a hit on the placed geometry.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record in world space.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if the placed geometry blocks a ray segment.
+    virtual void transform(const Matrix4& transform) override; // Applies a transform on top of the current placement.
+    virtual void bake() override; // Computes the world-space bounding box.
+    virtual AABB bounds() const override; // Gets the instance's world-space bounding box.
+
+private:
+    Ray toObjectSpace(const Ray& r) const; // Moves a world-space ray into object space.
+
+    std::shared_ptr<const GeometryGroup> geometry; // Shared, already baked geometry.
+    Matrix4 objectToWorld;  // Transform placing the geometry in the world.
+    Matrix4 worldToObject;  // Inverse transform.
+    Matrix4 normalToWorld;  // Inverse transpose, for normals.
+    AABB box;               // World-space bounding box.
+};
+
+#endif // INSTANCE_H
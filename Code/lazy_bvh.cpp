@@ -0,0 +1,169 @@
+#include "lazy_bvh.h"
+#include <thread>
+
+// Sets up the root over all primitives and splits the top levels.
+/**
+ * @param primBounds The bounding box of each primitive, indexed by primitive id.
+ * @param maxLeafSize The largest number of primitives a leaf may hold.
+ */
+void LazyBVH::build(const std::vector<AABB>& primBounds, int maxLeafSize) {
+    this->primBounds = primBounds;
+    this->maxLeafSize = maxLeafSize;
+    centroids.clear();
+    primIndices.clear();
+    nodes.reset();
+    nodeCount.store(0, std::memory_order_relaxed);
+    capacity = 0;
+    if (primBounds.empty()) return;
+
+    centroids.reserve(primBounds.size());
+    primIndices.reserve(primBounds.size());
+    for (size_t i = 0; i < primBounds.size(); ++i) {
+        centroids.push_back(primBounds[i].centroid());
+        primIndices.push_back(int(i));
+    }
+
+    // A binary tree over N leaves has at most 2N - 1 nodes
+    capacity = 2 * int(primBounds.size()) - 1;
+    nodes.reset(new LazyBVHNode[capacity]);
+    nodeCount.store(1, std::memory_order_relaxed);
+    initNode(0, 0, int(primBounds.size()), 0);
+
+    // Split the top levels breadth first; nodes are handed out in order, so every
+    // node below index end belongs to a level that still has to be split
+    int begin = 0;
+    for (int level = 0; level < eagerDepth; ++level) {
+        int end = nodeCount.load(std::memory_order_relaxed);
+        for (int index = begin; index < end; ++index) {
+            ready(index);
+        }
+        begin = end;
+    }
+}
+
+// Fills in a new, unsplit node.
+/**
+ * @param index The node to fill; it must not be visible to other threads yet.
+ * @param first The first primitive slot of the node's range.
+ * @param count The number of primitives in the range.
+ * @param depth The depth of the node in the tree.
+ */
+void LazyBVH::initNode(int index, int first, int count, int depth) const {
+    LazyBVHNode& node = nodes[index];
+    node.bounds = AABB();
+    for (int i = first; i < first + count; ++i) {
+        node.bounds.expand(primBounds[primIndices[i]]);
+    }
+    node.first = first;
+    node.count = count;
+    node.depth = depth;
+    node.left = 0;
+    node.axis = 0;
+    node.state.store(LazyBVHNode::Unbuilt, std::memory_order_relaxed);
+}
+
+// Splits a node if nobody has yet and returns its final state.
+/**
+ * The first thread to reach an unbuilt node claims it and splits it; others that
+ * arrive meanwhile wait for the split, which only touches the node's own range.
+ * @param index The node about to be traversed.
+ * @return LazyBVHNode::Inner or LazyBVHNode::Leaf.
+ */
+int LazyBVH::ready(int index) const {
+    LazyBVHNode& node = nodes[index];
+    int state = node.state.load(std::memory_order_acquire);
+    if (state == LazyBVHNode::Inner || state == LazyBVHNode::Leaf) return state;
+
+    int expected = LazyBVHNode::Unbuilt;
+    if (node.state.compare_exchange_strong(expected, LazyBVHNode::Building, std::memory_order_acquire)) {
+        state = split(index);
+        node.state.store(state, std::memory_order_release);
+        return state;
+    }
+
+    while ((state = node.state.load(std::memory_order_acquire)) == LazyBVHNode::Building) {
+        std::this_thread::yield();
+    }
+    return state;
+}
+
+// Splits a claimed node into two children or turns it into a leaf.
+/**
+ * @param index The node, claimed by the calling thread.
+ * @return The state the node ends up in.
+ */
+int LazyBVH::split(int index) const {
+    LazyBVHNode& node = nodes[index];
+    if (node.depth >= BVH::maxDepth) return LazyBVHNode::Leaf;
+
+    int axis;
+    int mid = BVH::partition(primIndices, node.first, node.count, node.bounds,
+                             primBounds, centroids, maxLeafSize, axis);
+    if (mid < 0) return LazyBVHNode::Leaf;
+
+    // Every split turns one leaf into two, so the preallocated array never runs out
+    int left = nodeCount.fetch_add(2, std::memory_order_relaxed);
+    initNode(left, node.first, mid - node.first, node.depth + 1);
+    initNode(left + 1, mid, node.first + node.count - mid, node.depth + 1);
+    node.left = left;
+    node.axis = axis;
+    return LazyBVHNode::Inner;
+}
+
+// Builds the top levels of the lazy BVH over the world's objects.
+/**
+ * @param objects The objects to index.
+ */
+void LazyBVHAccelerator::build(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    prims.build(objects);
+
+    std::vector<AABB> primBounds;
+    primBounds.reserve(objects.size());
+    for (const auto& object : objects) {
+        primBounds.push_back(object->bounds());
+    }
+    bvh.build(primBounds);
+}
+
+// Finds the closest intersection, splitting the nodes the ray reaches.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param rec The record to store hit information.
+ * @return True if the ray hits an object, false otherwise.
+ */
+bool LazyBVHAccelerator::hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    HitInfo info;
+    int closest = -1;
+    bool found = bvh.closestHit(r, t_min, t_max, [&](int prim, real tMin, real& tMax) {
+        if (prims.intersect(prim, r, tMin, tMax, info)) {
+            tMax = info.t;
+            closest = prim;
+            return true;
+        }
+        return false;
+    });
+    if (!found) return false;
+
+    prims.surface(closest, r, info, rec);
+    return true;
+}
+
+// Checks if any object blocks a ray segment, splitting the nodes the ray reaches.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param blocker If not null, receives the object that blocked the ray.
+ * @return True as soon as one object blocks the segment, false otherwise.
+ */
+bool LazyBVHAccelerator::occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker) const {
+    return bvh.anyHit(r, t_min, t_max, [&](int prim) {
+        if (prims.occludes(prim, r, t_min, t_max)) {
+            if (blocker) *blocker = prims.get(prim);
+            return true;
+        }
+        return false;
+    });
+}
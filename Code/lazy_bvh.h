@@ -0,0 +1,178 @@
+#ifndef LAZY_BVH_H
+#define LAZY_BVH_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include "bvh.h"
+#include "accelerator.h"
+
+/**
+ * @struct LazyBVHNode
+ * @brief A binary BVH node that is split the first time a ray reaches it.
+ *
+ * The node's box and primitive range are set when its parent is split; the split
+ * itself waits until traversal needs it. The state is only advanced by the thread
+ * that claimed the node, and published with release ordering, so a thread that
+ * reads Inner or Leaf also sees the finished children and primitive order.
+ */
+struct LazyBVHNode {
+    enum State { Unbuilt, Building, Inner, Leaf };
+
+    AABB bounds;            ///< Bounds of all primitives in the range.
+    int first;              ///< First primitive slot of the range.
+    int count;              ///< Number of primitives in the range.
+    int depth;              ///< Depth of the node in the tree.
+    int left;               ///< Index of the left child once split; the right child follows it.
+    int axis;               ///< Split axis, used to visit the nearer child first.
+    std::atomic<int> state; ///< One of State.
+};
+
+/**
+ * @class LazyBVH
+ * @brief Binary SAH hierarchy whose lower levels are built on demand during traversal.
+ *
+ * build() only splits the top levels; every other node is split by the first ray
+ * that hits its box, using the same binned SAH split as BVH. Subtrees no ray reaches
+ * are never built, which cuts the time to the first pixel for previews that see only
+ * part of a large scene. Nodes come from an array sized for the largest possible
+ * tree, so splitting only bumps an atomic counter and never moves existing nodes,
+ * and any number of render threads can split disjoint subtrees at the same time.
+ * The same primitive callbacks as BVH::closestHit and BVH::anyHit are used.
+ */
+class LazyBVH {
+public:
+    LazyBVH() : nodeCount(0), capacity(0) {} // Default constructor.
+
+    void build(const std::vector<AABB>& primBounds, int maxLeafSize = 4); // Sets up the root and splits the top levels.
+    bool empty() const { return capacity == 0; } // Checks if the hierarchy has been built.
+    int getNodeCount() const { return nodeCount.load(std::memory_order_relaxed); } // Gets the number of nodes created so far.
+
+    /**
+     * @brief Walks the hierarchy, splitting nodes as needed, and reports the closest primitive hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim, real t_min, real& t_max) that tests one
+     *                primitive and shrinks t_max on a hit.
+     * @return True if any primitive was hit, false otherwise.
+     */
+    template <typename PrimHit>
+    bool closestHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (empty()) return false;
+
+        vec3 origin = r.getOrigin();
+        vec3 direction = r.getDirection();
+        vec3 invDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+        bool hit_anything = false;
+        int stack[BVH::maxDepth + 2];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            int index = stack[--stackSize];
+            const LazyBVHNode& node = nodes[index];
+            if (!node.bounds.hit(origin, invDirection, t_min, t_max))
+                continue;
+
+            int state = node.state.load(std::memory_order_acquire);
+            if (state < LazyBVHNode::Inner) state = ready(index);
+
+            if (state == LazyBVHNode::Leaf) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (primHit(primIndices[i], t_min, t_max))
+                        hit_anything = true;
+                }
+                continue;
+            }
+
+            // Push the far child first so the near child is visited first
+            if (direction[node.axis] < 0) {
+                stack[stackSize++] = node.left;
+                stack[stackSize++] = node.left + 1;
+            } else {
+                stack[stackSize++] = node.left + 1;
+                stack[stackSize++] = node.left;
+            }
+        }
+        return hit_anything;
+    }
+
+    /**
+     * @brief Walks the hierarchy, splitting nodes as needed, until any primitive reports a hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim) that tests one primitive against [t_min, t_max].
+     * @return True as soon as a primitive is hit, false if none is.
+     */
+    template <typename PrimHit>
+    bool anyHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (empty()) return false;
+
+        vec3 origin = r.getOrigin();
+        vec3 direction = r.getDirection();
+        vec3 invDirection(1.0 / direction.x, 1.0 / direction.y, 1.0 / direction.z);
+
+        int stack[BVH::maxDepth + 2];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0) {
+            int index = stack[--stackSize];
+            const LazyBVHNode& node = nodes[index];
+            if (!node.bounds.hit(origin, invDirection, t_min, t_max))
+                continue;
+
+            int state = node.state.load(std::memory_order_acquire);
+            if (state < LazyBVHNode::Inner) state = ready(index);
+
+            if (state == LazyBVHNode::Leaf) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (primHit(primIndices[i]))
+                        return true;
+                }
+                continue;
+            }
+
+            stack[stackSize++] = node.left + 1;
+            stack[stackSize++] = node.left;
+        }
+        return false;
+    }
+
+    static const int eagerDepth = 6; // Levels split up front by build().
+
+private:
+    int ready(int index) const; // Splits a node if nobody has yet and returns its final state.
+    int split(int index) const; // Splits a claimed node into two children or turns it into a leaf.
+    void initNode(int index, int first, int count, int depth) const; // Fills in a new, unsplit node.
+
+    // Splitting happens inside const queries, so the tree itself is mutable
+    mutable std::unique_ptr<LazyBVHNode[]> nodes; // Preallocated nodes, root at index 0.
+    mutable std::vector<int> primIndices;         // Primitive order; each node only reorders its own range.
+    mutable std::atomic<int> nodeCount;           // Number of nodes handed out.
+    int capacity;                                 // Size of the node array.
+    int maxLeafSize;                              // Largest number of primitives a leaf may hold.
+    std::vector<AABB> primBounds;                 // Bounding box of each primitive.
+    std::vector<vec3> centroids;                  // Centroid of each primitive box.
+};
+
+/**
+ * @class LazyBVHAccelerator
+ * @brief Accelerator that walks a lazily built BVH over the world's objects.
+ */
+class LazyBVHAccelerator : public Accelerator {
+public:
+    virtual void build(const std::vector<std::shared_ptr<Hittable>>& objects) override; // Builds the top of the BVH.
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const override; // Closest-hit query.
+    virtual bool occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker = nullptr) const override; // Any-hit query.
+    virtual std::string name() const override { return "lazy"; }
+
+private:
+    PrimitiveArrays prims;                          // Copies of the objects indexed by the hierarchy.
+    LazyBVH bvh;                                    // Hierarchy over the object bounds.
+};
+
+#endif // LAZY_BVH_H
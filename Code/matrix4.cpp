@@ -0,0 +1,153 @@
+#include "matrix4.h"
+#include <cmath>
+#include <utility>
+
+// Default constructor: Initializes the matrix to the identity.
+Matrix4::Matrix4() {
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            m[i][j] = i == j ? 1.0 : 0.0;
+}
+
+// Gets the identity transform.
+/**
+ * @return The identity matrix.
+ */
+Matrix4 Matrix4::identity() {
+    return Matrix4();
+}
+
+// Gets a translation.
+/**
+ * @param offset The translation to apply.
+ * @return The matrix moving points by the offset.
+ */
+Matrix4 Matrix4::translation(const vec3& offset) {
+    Matrix4 result;
+    result.m[0][3] = offset.x;
+    result.m[1][3] = offset.y;
+    result.m[2][3] = offset.z;
+    return result;
+}
+
+// Gets a scale along the three axes.
+/**
+ * @param factors The scale factor along x, y and z.
+ * @return The matrix scaling points about the origin.
+ */
+Matrix4 Matrix4::scaling(const vec3& factors) {
+    Matrix4 result;
+    result.m[0][0] = factors.x;
+    result.m[1][1] = factors.y;
+    result.m[2][2] = factors.z;
+    return result;
+}
+
+// Composes two transforms.
+/**
+ * @param other The transform applied first.
+ * @return The product this * other.
+ */
+Matrix4 Matrix4::operator*(const Matrix4& other) const {
+    Matrix4 result;
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            double sum = 0;
+            for (int k = 0; k < 4; ++k)
+                sum += m[i][k] * other.m[k][j];
+            result.m[i][j] = sum;
+        }
+    }
+    return result;
+}
+
+// Gets the inverse transform using Gauss-Jordan elimination with partial pivoting.
+/**
+ * @return The inverse matrix, or the identity if the matrix is singular.
+ */
+Matrix4 Matrix4::inverse() const {
+    double a[4][8];
+    for (int i = 0; i < 4; ++i) {
+        for (int j = 0; j < 4; ++j) {
+            a[i][j] = m[i][j];
+            a[i][j + 4] = i == j ? 1.0 : 0.0;
+        }
+    }
+
+    for (int column = 0; column < 4; ++column) {
+        int pivot = column;
+        for (int row = column + 1; row < 4; ++row) {
+            if (std::abs(a[row][column]) > std::abs(a[pivot][column]))
+                pivot = row;
+        }
+        if (std::abs(a[pivot][column]) < 1e-12)
+            return Matrix4();
+        if (pivot != column) {
+            for (int j = 0; j < 8; ++j)
+                std::swap(a[pivot][j], a[column][j]);
+        }
+
+        double invPivot = 1.0 / a[column][column];
+        for (int j = 0; j < 8; ++j)
+            a[column][j] *= invPivot;
+
+        for (int row = 0; row < 4; ++row) {
+            if (row == column) continue;
+            double factor = a[row][column];
+            for (int j = 0; j < 8; ++j)
+                a[row][j] -= factor * a[column][j];
+        }
+    }
+
+    Matrix4 result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.m[i][j] = a[i][j + 4];
+    return result;
+}
+
+// Gets the transposed matrix.
+/**
+ * @return The matrix with rows and columns swapped.
+ */
+Matrix4 Matrix4::transpose() const {
+    Matrix4 result;
+    for (int i = 0; i < 4; ++i)
+        for (int j = 0; j < 4; ++j)
+            result.m[i][j] = m[j][i];
+    return result;
+}
+
+// Gets the uniform scale of a similarity transform.
+/**
+ * @return The cube root of the absolute determinant of the 3x3 linear part, which is
+ *         the scale factor when the transform is a rotation, translation and uniform scale.
+ */
+double Matrix4::scaleFactor() const {
+    double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+               - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+               + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    return std::cbrt(std::abs(det));
+}
+
+// Transforms a point, applying the translation.
+/**
+ * @param p The point to transform.
+ * @return The transformed point.
+ */
+vec3 Matrix4::transformPoint(const vec3& p) const {
+    return vec3(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3],
+                m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3],
+                m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3]);
+}
+
+// Transforms a direction, ignoring the translation.
+/**
+ * @param v The direction to transform.
+ * @return The transformed direction, not normalized.
+ */
+vec3 Matrix4::transformVector(const vec3& v) const {
+    return vec3(m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+                m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+                m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z);
+}
@@ -0,0 +1,29 @@
+#ifndef MATRIX4_H
+#define MATRIX4_H
+
+#include "vector.h"
+
+/**
+ * @class Matrix4
+ * @brief Row-major 4x4 affine transform acting on column vectors.
+ */
+class Matrix4 {
+public:
+    double m[4][4]; ///< Elements, m[row][column].
+
+    Matrix4(); // Default constructor, creates the identity.
+
+    static Matrix4 identity(); // Gets the identity transform.
+    static Matrix4 translation(const vec3& offset); // Gets a translation.
+    static Matrix4 scaling(const vec3& factors); // Gets a scale along the three axes.
+
+    Matrix4 operator*(const Matrix4& other) const; // Composes two transforms, applying other first.
+    Matrix4 inverse() const; // Gets the inverse transform.
+    Matrix4 transpose() const; // Gets the transposed matrix.
+    double scaleFactor() const; // Gets the uniform scale of a similarity transform.
+
+    vec3 transformPoint(const vec3& p) const; // Transforms a point, applying the translation.
+    vec3 transformVector(const vec3& v) const; // Transforms a direction, ignoring the translation.
+};
+
+#endif // MATRIX4_H
@@ -0,0 +1,241 @@
+#include "mesh.h"
+#include <iostream>
+
+// Appends a vertex with planar texture coordinates.
+/**
+ * Uses the vertex x and y as texture coordinates, like a single triangle does.
+ * @param position The position of the vertex.
+ * @return The index of the new vertex.
+ */
+int Mesh::addVertex(const vec3& position) {
+    return addVertex(position, position.x, position.y);
+}
+
+// Appends a vertex with texture coordinates.
+/**
+ * @param position The position of the vertex.
+ * @param u The U texture coordinate.
+ * @param v The V texture coordinate.
+ * @return The index of the new vertex.
+ */
+int Mesh::addVertex(const vec3& position, real u, real v) {
+    px.push_back(position.x);
+    py.push_back(position.y);
+    pz.push_back(position.z);
+    tu.push_back(u);
+    tv.push_back(v);
+    return int(px.size()) - 1;
+}
+
+// Appends a triangle over three existing vertices.
+/**
+ * @param i0 The index of the first vertex.
+ * @param i1 The index of the second vertex.
+ * @param i2 The index of the third vertex.
+ * @return True if the triangle was added, false if an index is out of range.
+ */
+bool Mesh::addTriangle(int i0, int i1, int i2) {
+    int vertexCount = getVertexCount();
+    if (i0 < 0 || i1 < 0 || i2 < 0 || i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount) {
+        std::cerr << "Mesh triangle (" << i0 << ", " << i1 << ", " << i2 << ") references a missing vertex, skipping it." << std::endl;
+        return false;
+    }
+    indices.push_back(i0);
+    indices.push_back(i1);
+    indices.push_back(i2);
+    return true;
+}
+
+// Gets the number of vertices.
+/**
+ * @return The number of vertices in the mesh.
+ */
+int Mesh::getVertexCount() const {
+    return int(px.size());
+}
+
+// Gets the number of triangles.
+/**
+ * @return The number of triangles in the mesh.
+ */
+int Mesh::getTriangleCount() const {
+    return int(indices.size() / 3);
+}
+
+// Sets the material of the mesh.
+/**
+ * @param materialId The index of the material in the world's material table.
+ * @param material The material itself, used to pick up its shared texture.
+ */
+void Mesh::setMaterial(int materialId, const Material& material) {
+    this->materialId = materialId;
+    this->texture = material.getTextureHandle();
+    this->textureIsSet = material.hasTexture();
+}
+
+// Gathers a vertex position from the position arrays.
+/**
+ * @param vertex The index of the vertex.
+ * @return The position of the vertex.
+ */
+vec3 Mesh::position(int vertex) const {
+    return vec3(px[vertex], py[vertex], pz[vertex]);
+}
+
+// Computes the box of every triangle and of the whole mesh.
+/**
+ * @param meshBox Receives the box of the whole mesh.
+ * @return The box of each triangle.
+ */
+std::vector<AABB> Mesh::triangleBounds(AABB& meshBox) const {
+    std::vector<AABB> bounds(getTriangleCount());
+    meshBox = AABB();
+    for (int i = 0; i < getTriangleCount(); ++i) {
+        bounds[i].expand(position(indices[3 * i]));
+        bounds[i].expand(position(indices[3 * i + 1]));
+        bounds[i].expand(position(indices[3 * i + 2]));
+        meshBox.expand(bounds[i]);
+    }
+    return bounds;
+}
+
+// Builds the triangle BVH and the bounding box.
+void Mesh::bake() {
+    bvh.build(triangleBounds(box));
+}
+
+// Moves every vertex and refits the triangle BVH.
+/**
+ * The triangles keep their neighbours under a transform, so the existing tree is
+ * refitted rather than rebuilt, unless the refit degrades it too much.
+ * @param transform The transform to apply.
+ */
+void Mesh::transform(const Matrix4& transform) {
+    for (int i = 0; i < getVertexCount(); ++i) {
+        vec3 p = transform.transformPoint(position(i));
+        px[i] = p.x;
+        py[i] = p.y;
+        pz[i] = p.z;
+    }
+
+    std::vector<AABB> bounds = triangleBounds(box);
+    bvh.refit(bounds);
+    if (bvh.needsRebuild()) {
+        bvh.build(bounds);
+    }
+}
+
+// Gets the bounding box of the mesh.
+/**
+ * @return The baked box spanning all vertices used by triangles.
+ */
+AABB Mesh::bounds() const {
+    return box;
+}
+
+// Checks for an intersection with one triangle using the Möller–Trumbore algorithm.
+/**
+ * @param triangle The index of the triangle.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param t Receives the ray parameter of the hit.
+ * @param u Receives the barycentric weight of the second vertex.
+ * @param v Receives the barycentric weight of the third vertex.
+ * @return True if the ray crosses the triangle within [t_min, t_max], false otherwise.
+ */
+bool Mesh::intersectTriangle(int triangle, const Ray& r, real t_min, real t_max,
+                             real& t, real& u, real& v) const {
+    const real EPSILON = 1e-6;
+
+    vec3 v0 = position(indices[3 * triangle]);
+    vec3 edge1 = position(indices[3 * triangle + 1]) - v0;
+    vec3 edge2 = position(indices[3 * triangle + 2]) - v0;
+    vec3 h = vec3::cross(r.getDirection(), edge2);
+    real a = vec3::dot(edge1, h);
+
+    if (a > -EPSILON && a < EPSILON)
+        return false;
+
+    real f = 1.0 / a;
+    vec3 s = r.getOrigin() - v0;
+    u = f * vec3::dot(s, h);
+
+    if (u < 0.0 || u > 1.0)
+        return false;
+
+    vec3 q = vec3::cross(s, edge1);
+    v = f * vec3::dot(r.getDirection(), q);
+
+    if (v < 0.0 || u + v > 1.0)
+        return false;
+
+    t = f * vec3::dot(edge2, q);
+    return t > t_min && t < t_max;
+}
+
+// Finds the closest triangle hit by walking the mesh's BVH.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the hit distance, the triangle index and its barycentrics.
+ * @return True if the ray hits a triangle of the mesh, false otherwise.
+ */
+bool Mesh::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    return bvh.closestHit(r, t_min, t_max, [&](int triangle, real tMin, real& tMax) {
+        real t, u, v;
+        if (intersectTriangle(triangle, r, tMin, tMax, t, u, v)) {
+            tMax = t;
+            info.t = t;
+            info.u = u;
+            info.v = v;
+            info.prim = triangle;
+            info.depth = 0;
+            return true;
+        }
+        return false;
+    });
+}
+
+// Fills in the hit record for the triangle found by intersect.
+/**
+ * @param r The ray that hit the mesh.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void Mesh::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    int i0 = indices[3 * info.prim];
+    int i1 = indices[3 * info.prim + 1];
+    int i2 = indices[3 * info.prim + 2];
+    vec3 v0 = position(i0);
+    vec3 edge1 = position(i1) - v0;
+    vec3 edge2 = position(i2) - v0;
+
+    rec.materialId = materialId;
+    rec.textured = textureIsSet;
+    rec.normal = vec3::cross(edge1, edge2).return_unit();
+    rec.t = info.t;
+    rec.p = r.pointAtParameter(rec.t);
+
+    if (textureIsSet) {
+        real w = 1 - info.u - info.v;
+        real u = tu[i0] * w + tu[i1] * info.u + tu[i2] * info.v;
+        real v = tv[i0] * w + tv[i1] * info.u + tv[i2] * info.v;
+        rec.textureColor = texture->getColor(u, v);
+    }
+}
+
+// Checks if any triangle of the mesh blocks a ray segment.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True as soon as one triangle blocks the segment, false otherwise.
+ */
+bool Mesh::occludes(const Ray& r, real t_min, real t_max) const {
+    return bvh.anyHit(r, t_min, t_max, [&](int triangle) {
+        real t, u, v;
+        return intersectTriangle(triangle, r, t_min, t_max, t, u, v);
+    });
+}
@@ -0,0 +1,52 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+#include "hittable.h"
+#include "Material.h"
+#include "wide_bvh.h"
+
+/**
+ * @class Mesh
+ * @brief Indexed triangle mesh with one material, stored as shared vertex and index buffers.
+ *
+ * Vertex positions and texture coordinates are kept in structure-of-arrays form and
+ * every triangle is three indices into them, so shared vertices are stored once. The
+ * mesh builds its own BVH over its triangles and takes part in the world's
+ * acceleration structure as a single object.
+ */
+class Mesh : public Hittable {
+public:
+    Mesh() : materialId(0), textureIsSet(false) {} // Default constructor.
+
+    int addVertex(const vec3& position); // Appends a vertex with planar texture coordinates and returns its index.
+    int addVertex(const vec3& position, real u, real v); // Appends a vertex with texture coordinates and returns its index.
+    bool addTriangle(int i0, int i1, int i2); // Appends a triangle over three existing vertices.
+    int getVertexCount() const; // Gets the number of vertices.
+    int getTriangleCount() const; // Gets the number of triangles.
+    void setMaterial(int materialId, const Material& material); // Sets the mesh's material from the world's material table.
+
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Finds the closest triangle hit.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record for the triangle hit.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if any triangle blocks a ray segment.
+    virtual void transform(const Matrix4& transform) override; // Moves every vertex and refits the triangle BVH.
+    virtual void bake() override; // Builds the triangle BVH and the bounding box.
+    virtual AABB bounds() const override; // Gets the mesh's bounding box.
+
+private:
+    bool intersectTriangle(int triangle, const Ray& r, real t_min, real t_max,
+                           real& t, real& u, real& v) const; // Möller–Trumbore test against one triangle.
+    vec3 position(int vertex) const; // Gathers a vertex position from the position arrays.
+    std::vector<AABB> triangleBounds(AABB& meshBox) const; // Computes the box of every triangle and of the whole mesh.
+
+    std::vector<real> px, py, pz; // Vertex positions, one array per component.
+    std::vector<real> tu, tv;     // Vertex texture coordinates, one array per component.
+    std::vector<int> indices;       // Three vertex indices per triangle.
+    WideBVH bvh;                    // Hierarchy over the triangles.
+    AABB box;                       // Baked bounding box.
+    int materialId;                 // Index into the world's material table.
+    std::shared_ptr<const Texture> texture; // Shared texture of the material, null if untextured.
+    bool textureIsSet;              // Texture flag.
+};
+
+#endif // MESH_H
@@ -0,0 +1,62 @@
+#include "primitives.h"
+
+// Copies the objects into the per-type arrays.
+/**
+ * Objects are stored in the given order, so an accelerator that visits objects in
+ * a known order, such as BVH leaf order, gets neighbouring leaves next to each
+ * other in memory. References stay indexed like the object list either way.
+ * @param objects The objects to copy.
+ * @param order The order to store the objects in; empty for list order.
+ */
+void PrimitiveArrays::build(const std::vector<std::shared_ptr<Hittable>>& objects, const std::vector<int>& order) {
+    refs.assign(objects.size(), PrimRef());
+    spheres.clear();
+    triangles.clear();
+    cylinders.clear();
+    circles.clear();
+    clusters.clear();
+    others.clear();
+
+    for (size_t i = 0; i < objects.size(); ++i) {
+        int object = order.empty() ? int(i) : order[i];
+        const Hittable* hittable = objects[object].get();
+
+        if (const Sphere* sphere = dynamic_cast<const Sphere*>(hittable)) {
+            refs[object] = PrimRef(PrimRef::SphereType, uint32_t(spheres.size()));
+            spheres.push_back(*sphere);
+        } else if (const Triangle* triangle = dynamic_cast<const Triangle*>(hittable)) {
+            refs[object] = PrimRef(PrimRef::TriangleType, uint32_t(triangles.size()));
+            triangles.push_back(*triangle);
+        } else if (const Cylinder* cylinder = dynamic_cast<const Cylinder*>(hittable)) {
+            refs[object] = PrimRef(PrimRef::CylinderType, uint32_t(cylinders.size()));
+            cylinders.push_back(*cylinder);
+        } else if (const Circle* circle = dynamic_cast<const Circle*>(hittable)) {
+            refs[object] = PrimRef(PrimRef::CircleType, uint32_t(circles.size()));
+            circles.push_back(*circle);
+        } else if (const SphereCluster* cluster = dynamic_cast<const SphereCluster*>(hittable)) {
+            refs[object] = PrimRef(PrimRef::ClusterType, uint32_t(clusters.size()));
+            clusters.push_back(*cluster);
+        } else {
+            refs[object] = PrimRef(PrimRef::OtherType, uint32_t(others.size()));
+            others.push_back(objects[object]);
+        }
+    }
+}
+
+// Gets the stored primitive of an object.
+/**
+ * @param object The index of the object, as in the list passed to build.
+ * @return The copy in the per-type array, or the object itself for other types.
+ *         Copies live until the next build.
+ */
+const Hittable* PrimitiveArrays::get(int object) const {
+    PrimRef ref = refs[object];
+    switch (ref.type()) {
+    case PrimRef::SphereType:   return &spheres[ref.index()];
+    case PrimRef::TriangleType: return &triangles[ref.index()];
+    case PrimRef::CylinderType: return &cylinders[ref.index()];
+    case PrimRef::CircleType:   return &circles[ref.index()];
+    case PrimRef::ClusterType:  return &clusters[ref.index()];
+    default:                    return others[ref.index()].get();
+    }
+}
@@ -0,0 +1,183 @@
+#ifndef PRIMITIVES_H
+#define PRIMITIVES_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "hittable.h"
+#include "Sphere.h"
+#include "triangle.h"
+#include "cylinder.h"
+#include "circle.h"
+#include "sphere_cluster.h"
+
+/**
+ * @struct PrimRef
+ * @brief Compact reference to a primitive: a type tag and an index into that type's array.
+ */
+struct PrimRef {
+    enum Type { SphereType, TriangleType, CylinderType, CircleType, ClusterType, OtherType };
+
+    static const int typeBits = 3;                 ///< Bits of the tag, stored at the top.
+    static const uint32_t indexMask = (1u << (32 - typeBits)) - 1; ///< Bits of the index.
+
+    uint32_t bits; ///< Type tag and index packed together.
+
+    PrimRef() : bits(0) {} // Default constructor.
+    PrimRef(Type type, uint32_t index) : bits((uint32_t(type) << (32 - typeBits)) | (index & indexMask)) {} // Constructor.
+
+    Type type() const { return Type(bits >> (32 - typeBits)); } // Gets the type tag.
+    uint32_t index() const { return bits & indexMask; } // Gets the index into the type's array.
+};
+
+/**
+ * @class PrimitiveArrays
+ * @brief Copies of the world's objects, stored by value in one contiguous array per built-in type.
+ *
+ * Accelerators keep one of these instead of a list of object pointers. Built-in
+ * shapes are tested through a switch on the reference's tag and a direct call on
+ * an array element, so there is no pointer chase to a scattered heap object and no
+ * virtual call. Any other Hittable, such as a mesh or an instance, still goes
+ * through its pointer. Closest-hit searches call intersect on every candidate and
+ * surface once, for the winner. The copies have to be refreshed when the objects change.
+ */
+class PrimitiveArrays {
+public:
+    void build(const std::vector<std::shared_ptr<Hittable>>& objects, const std::vector<int>& order = std::vector<int>()); // Copies the objects into the per-type arrays.
+    size_t size() const { return refs.size(); } // Gets the number of primitives.
+    PrimRef ref(int object) const { return refs[object]; } // Gets the reference of an object.
+
+    /**
+     * @brief Finds where a ray hits one primitive, without computing hit attributes.
+     * @param object The index of the object, as in the list passed to build.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param info Receives the primitive's hit.
+     * @return True if the ray hits the primitive, false otherwise.
+     */
+    bool intersect(int object, const Ray& r, real t_min, real t_max, HitInfo& info) const {
+        PrimRef ref = refs[object];
+        switch (ref.type()) {
+        case PrimRef::SphereType:   return spheres[ref.index()].intersect(r, t_min, t_max, info);
+        case PrimRef::TriangleType: return triangles[ref.index()].intersect(r, t_min, t_max, info);
+        case PrimRef::CylinderType: return cylinders[ref.index()].intersect(r, t_min, t_max, info);
+        case PrimRef::CircleType:   return circles[ref.index()].intersect(r, t_min, t_max, info);
+        case PrimRef::ClusterType:  return clusters[ref.index()].intersect(r, t_min, t_max, info);
+        default:                    return others[ref.index()]->intersect(r, t_min, t_max, info);
+        }
+    }
+
+    /**
+     * @brief Fills in the hit record for a hit found by intersect.
+     * @param object The index of the object that was hit.
+     * @param r The ray passed to intersect.
+     * @param info The result of intersect.
+     * @param rec The record to store hit information.
+     */
+    void surface(int object, const Ray& r, const HitInfo& info, HitRecord& rec) const {
+        PrimRef ref = refs[object];
+        switch (ref.type()) {
+        case PrimRef::SphereType:   spheres[ref.index()].surface(r, info, rec); break;
+        case PrimRef::TriangleType: triangles[ref.index()].surface(r, info, rec); break;
+        case PrimRef::CylinderType: cylinders[ref.index()].surface(r, info, rec); break;
+        case PrimRef::CircleType:   circles[ref.index()].surface(r, info, rec); break;
+        case PrimRef::ClusterType:  clusters[ref.index()].surface(r, info, rec); break;
+        default:                    others[ref.index()]->surface(r, info, rec); break;
+        }
+    }
+
+    /**
+     * @brief Checks if one primitive blocks a ray segment.
+     * @param object The index of the object, as in the list passed to build.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @return True if the primitive blocks the segment, false otherwise.
+     */
+    bool occludes(int object, const Ray& r, real t_min, real t_max) const {
+        PrimRef ref = refs[object];
+        switch (ref.type()) {
+        case PrimRef::SphereType:   return spheres[ref.index()].occludes(r, t_min, t_max);
+        case PrimRef::TriangleType: return triangles[ref.index()].occludes(r, t_min, t_max);
+        case PrimRef::CylinderType: return cylinders[ref.index()].occludes(r, t_min, t_max);
+        case PrimRef::CircleType:   return circles[ref.index()].occludes(r, t_min, t_max);
+        case PrimRef::ClusterType:  return clusters[ref.index()].occludes(r, t_min, t_max);
+        default:                    return others[ref.index()]->occludes(r, t_min, t_max);
+        }
+    }
+
+    /**
+     * @brief Finds where the rays of a packet hit one primitive.
+     * @param object The index of the object, as in the list passed to build.
+     * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+     * @param mask The lanes to test.
+     * @param info Receives the hit of each lane that hits, indexed by lane.
+     * @return The bit mask of lanes that hit the primitive.
+     */
+    int intersectPacket(int object, RayPacket& packet, int mask, HitInfo info[]) const {
+        // A few rays are cheaper to test one by one than with full packet lanes
+        if (__builtin_popcount(mask) < RayPacket::minLanes) {
+            int hits = 0;
+            for (int lanes = mask; lanes; lanes &= lanes - 1) {
+                int lane = __builtin_ctz(lanes);
+                if (intersect(object, packet.ray(lane), packet.tMin, packet.tMax[lane], info[lane])) {
+                    packet.tMax[lane] = info[lane].t;
+                    hits |= 1 << lane;
+                }
+            }
+            return hits;
+        }
+
+        PrimRef ref = refs[object];
+        switch (ref.type()) {
+        case PrimRef::SphereType:   return spheres[ref.index()].intersectPacket(packet, mask, info);
+        case PrimRef::TriangleType: return triangles[ref.index()].intersectPacket(packet, mask, info);
+        case PrimRef::CylinderType: return cylinders[ref.index()].intersectPacket(packet, mask, info);
+        case PrimRef::CircleType:   return circles[ref.index()].intersectPacket(packet, mask, info);
+        case PrimRef::ClusterType:  return clusters[ref.index()].intersectPacket(packet, mask, info);
+        default:                    return others[ref.index()]->intersectPacket(packet, mask, info);
+        }
+    }
+
+    /**
+     * @brief Checks which rays of a packet one primitive blocks.
+     * @param object The index of the object, as in the list passed to build.
+     * @param packet The rays, each with its own range.
+     * @param mask The lanes to test.
+     * @return The bit mask of lanes the primitive blocks.
+     */
+    int occludesPacket(int object, const RayPacket& packet, int mask) const {
+        if (__builtin_popcount(mask) < RayPacket::minLanes) {
+            int blocked = 0;
+            for (int lanes = mask; lanes; lanes &= lanes - 1) {
+                int lane = __builtin_ctz(lanes);
+                if (occludes(object, packet.ray(lane), packet.tMin, packet.tMax[lane])) blocked |= 1 << lane;
+            }
+            return blocked;
+        }
+
+        PrimRef ref = refs[object];
+        switch (ref.type()) {
+        case PrimRef::SphereType:   return spheres[ref.index()].occludesPacket(packet, mask);
+        case PrimRef::TriangleType: return triangles[ref.index()].occludesPacket(packet, mask);
+        case PrimRef::CylinderType: return cylinders[ref.index()].occludesPacket(packet, mask);
+        case PrimRef::CircleType:   return circles[ref.index()].occludesPacket(packet, mask);
+        case PrimRef::ClusterType:  return clusters[ref.index()].occludesPacket(packet, mask);
+        default:                    return others[ref.index()]->occludesPacket(packet, mask);
+        }
+    }
+
+    const Hittable* get(int object) const; // Gets the stored primitive of an object.
+
+private:
+    std::vector<PrimRef> refs;         // Reference of each object, indexed like the list passed to build.
+    std::vector<Sphere> spheres;       // Single spheres.
+    std::vector<Triangle> triangles;   // Single triangles.
+    std::vector<Cylinder> cylinders;   // Closed cylinders.
+    std::vector<Circle> circles;       // Discs.
+    std::vector<SphereCluster> clusters; // SIMD sphere clusters.
+    std::vector<std::shared_ptr<Hittable>> others; // Every other kind of object, through its pointer.
+};
+
+#endif // PRIMITIVES_H
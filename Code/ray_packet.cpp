@@ -0,0 +1,91 @@
+#include "ray_packet.h"
+#include "cpu_dispatch.h"
+#include <limits>
+
+// Constructor: Creates a packet with no active rays.
+RayPacket::RayPacket() : tMin(0), active(0) {
+    clear();
+}
+
+// Stores a ray in a lane and activates it.
+/**
+ * @param lane The lane, from 0 to size - 1; lane k is pixel (k % width, k / width) of the block.
+ * @param ray The ray; its range starts out unbounded above.
+ */
+void RayPacket::set(int lane, const Ray& ray) {
+    rays[lane] = ray;
+    const vec3& origin = ray.getOrigin();
+    const vec3& direction = ray.getDirection();
+    ox[lane] = origin.x;
+    oy[lane] = origin.y;
+    oz[lane] = origin.z;
+    dx[lane] = direction.x;
+    dy[lane] = direction.y;
+    dz[lane] = direction.z;
+    ix[lane] = 1.0 / direction.x;
+    iy[lane] = 1.0 / direction.y;
+    iz[lane] = 1.0 / direction.z;
+    tMax[lane] = std::numeric_limits<real>::infinity();
+    active |= 1 << lane;
+}
+
+// Deactivates every lane and zeroes its components.
+void RayPacket::clear() {
+    Lanes zero = {};
+    ox = oy = oz = zero;
+    dx = dy = dz = zero;
+    ix = iy = iz = zero;
+    tMax = zero;
+    active = 0;
+}
+
+namespace {
+
+// Clips one axis of a packet's ranges against a pair of slabs.
+/**
+ * Follows the comparisons of AABB::hit exactly, including how NaN distances
+ * from rays lying in a slab plane fall through them.
+ * @param lo The lower slab.
+ * @param hi The upper slab.
+ * @param origin The origin component of each ray.
+ * @param inverse The reciprocal direction component of each ray.
+ * @param tMin The lower end of each range, raised to where the rays enter the slabs.
+ * @param tMax The upper end of each range, lowered to where the rays leave the slabs.
+ */
+RT_ALWAYS_INLINE void clipSlab(real lo, real hi, const RayPacket::Lanes& origin, const RayPacket::Lanes& inverse,
+                            RayPacket::Lanes& tMin, RayPacket::Lanes& tMax) {
+    RayPacket::Lanes tNear = (lo - origin) * inverse;
+    RayPacket::Lanes tFar = (hi - origin) * inverse;
+    RayPacket::LaneMask swap = tNear > tFar;
+    RayPacket::Lanes enter = swap ? tFar : tNear;
+    RayPacket::Lanes exit = swap ? tNear : tFar;
+    tMin = enter > tMin ? enter : tMin;
+    tMax = exit < tMax ? exit : tMax;
+}
+
+// Packet slab test, compiled once per instruction set level below.
+RT_ALWAYS_INLINE int boxHitsKernel(const RayPacket& packet, const AABB& box) {
+    RayPacket::Lanes lower = {};
+    lower += packet.tMin;
+    RayPacket::Lanes upper = packet.tMax;
+    clipSlab(box.min.x, box.max.x, packet.ox, packet.ix, lower, upper);
+    RayPacket::LaneMask missed = lower > upper;
+    clipSlab(box.min.y, box.max.y, packet.oy, packet.iy, lower, upper);
+    missed |= lower > upper;
+    clipSlab(box.min.z, box.max.z, packet.oz, packet.iz, lower, upper);
+    missed |= lower > upper;
+    return RayPacket::bits(~missed);
+}
+
+RT_ISA_VARIANTS(int, boxHits, (const RayPacket& packet, const AABB& box), (packet, box))
+
+} // namespace
+
+// Slab-tests every ray against a box.
+/**
+ * @param box The box to test.
+ * @return The bit mask of lanes whose range overlaps the box.
+ */
+int RayPacket::hitsBox(const AABB& box) const {
+    return boxHits(*this, box);
+}
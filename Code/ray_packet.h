@@ -0,0 +1,72 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include <cmath>
+#include <cstdint>
+#include "Ray.h"
+#include "aabb.h"
+
+/**
+ * @class RayPacket
+ * @brief A 4x2 block of camera rays, stored one vector per component and traced together.
+ *
+ * Components are GCC vector types holding one value per ray, so arithmetic on them
+ * compiles to whatever SIMD the target has: two AVX registers, four SSE2 registers
+ * or plain scalar code. A ray takes part in a query when its bit is set in the
+ * active mask; the lanes of inactive rays hold zeros and their results are ignored.
+ */
+class RayPacket {
+public:
+    static const int width = 4;              ///< Pixels covered across.
+    static const int height = 2;             ///< Pixels covered down.
+    static const int size = width * height;  ///< Rays per packet.
+#if defined(__AVX__)
+    static const int minLanes = size * sizeof(real) / 32; ///< Fewest rays for which a packet test beats testing them one by one.
+#else
+    static const int minLanes = size * sizeof(real) / 16;
+#endif
+
+#ifdef RT_SINGLE_PRECISION
+    typedef int32_t LaneBits;
+#else
+    typedef int64_t LaneBits;
+#endif
+    typedef real Lanes __attribute__((vector_size(size * sizeof(real))));         ///< One value per ray.
+    typedef LaneBits LaneMask __attribute__((vector_size(size * sizeof(real))));  ///< Per-ray comparison, all bits set where true.
+
+    RayPacket(); // Constructor, creates a packet with no active rays.
+
+    void set(int lane, const Ray& ray); // Stores a ray in a lane with an unbounded range and activates it.
+    void clear(); // Deactivates every lane.
+    const Ray& ray(int lane) const { return rays[lane]; } // Gets the ray of a lane.
+    int activeMask() const { return active; } // Gets the bit mask of active lanes.
+    int hitsBox(const AABB& box) const; // Slab-tests every ray against a box, lane for lane like AABB::hit.
+
+    // Turns a per-ray comparison into a bit mask, bit k for lane k.
+    static int bits(const LaneMask& mask) {
+        int result = 0;
+        for (int lane = 0; lane < size; ++lane) {
+            if (mask[lane]) result |= 1 << lane;
+        }
+        return result;
+    }
+
+    // Takes the square root of every lane in place.
+    static void sqrt(Lanes& x) {
+        for (int lane = 0; lane < size; ++lane) {
+            x[lane] = std::sqrt(x[lane]);
+        }
+    }
+
+    Lanes ox, oy, oz; ///< Origin components.
+    Lanes dx, dy, dz; ///< Direction components.
+    Lanes ix, iy, iz; ///< Reciprocal direction components.
+    Lanes tMax;       ///< Upper end of each ray's valid range, shrunk as closer hits are found.
+    real tMin;        ///< Lower end of the valid range, shared by all rays.
+
+private:
+    Ray rays[size];   // The rays, for per-ray fallbacks and hit records.
+    int active;       // Bit mask of active lanes.
+};
+
+#endif // RAY_PACKET_H
@@ -3,7 +3,8 @@
 #include "Camera.h"
 #include "vector.h"
 #include "tonemapping.h"
-#include "combine_ppms.h"
+#include "framebuffer.h"
+#include "cpu_dispatch.h"
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -158,13 +159,14 @@ int main() {
     std::cout << "VideoLocation Directory: " << VideoLocation << std::endl;
     std::cout << "VideoFramesLocation Directory: " << VideoFramesLocation << std::endl;
     std::cout << "jsonFilesLocation Directory: " << jsonFilesLocation << std::endl;
+    std::cout << "SIMD kernels: " << isaName(activeIsa()) << " (set RT_ISA to override)" << std::endl;
 
     Camera cam;
 
     // List of scenes to render
     std::vector<std::string> scenes = {"mirror_image", "simple_phong", "binary_primitves", "mirror_image", "scene", "scene2"};
 
-    int threads_to_run = 10; // Number of threads for parallel rendering
+    int threads_to_run = 0; // Number of threads for parallel rendering, 0 uses every hardware thread
     int num_of_pixel_samples = 10; // Number of samples per pixel
 
     for (const auto& scene : scenes) {
@@ -175,20 +177,21 @@ int main() {
         // Load the scene
         world.loadScene(jsonFilesLocation + os_sep + scene + ".json", cam, jsonFilesLocation);
 
-        // Render the scene in parallel
-        cam.renderParallel(threads_to_run, num_of_pixel_samples, world, TestSuiteLocation + os_sep + scene + ".ppm");
+        // Render the scene in parallel into an in-memory HDR framebuffer
+        Framebuffer framebuffer;
+        cam.renderParallel(threads_to_run, num_of_pixel_samples, world, framebuffer);
         std::cout << "Finished rendering " + scene << std::endl;
 
-        // Perform tone mapping
-        std::string inputFilename = TestSuiteLocation + os_sep + scene + ".ppm";
+        // Write the rendered image once
+        framebuffer.writePPM(TestSuiteLocation + os_sep + scene + ".ppm");
+
+        // Perform tone mapping straight from the framebuffer
         std::string outputFilename = TestSuiteLocation + os_sep + "tonemapped_" + scene + ".ppm";
 
         float key = 0.18f; // Key value for tone mapping
-        int width, height;
-        std::vector<Pixel> image;
-
-        // Read the input image
-        readPPM(inputFilename, image, width, height);
+        int width = framebuffer.getWidth();
+        int height = framebuffer.getHeight();
+        std::vector<Pixel> image = framebuffer.getPixels();
 
         // Apply Reinhard tone mapping
         toneMapReinhard(image, width, height, key);
@@ -0,0 +1,64 @@
+#include "sampler.h"
+
+namespace {
+
+// Finalising mixer of SplitMix64; a bijection with full avalanche on 64-bit input.
+uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+} // namespace
+
+// Constructor: Initializes the stream for one sample of one pixel.
+/**
+ * @param pixelX The horizontal pixel index.
+ * @param pixelY The vertical pixel index.
+ * @param sampleIndex The index of the sample within the pixel.
+ * @param seed An extra seed, e.g. to decorrelate frames of an animation.
+ */
+Sampler::Sampler(uint32_t pixelX, uint32_t pixelY, uint32_t sampleIndex, uint32_t seed)
+    : key(mix64((uint64_t(pixelY) << 32 | pixelX) ^ mix64(uint64_t(seed) << 32 | sampleIndex))), dimension(0) {}
+
+// Gets the next number of the stream.
+/**
+ * @return A uniformly distributed double in [0, 1).
+ */
+double Sampler::next1D() {
+    uint64_t bits = mix64(key + 0x9e3779b97f4a7c15ULL * (uint64_t(dimension) + 1));
+    ++dimension;
+    // Use the top 53 bits to fill the double mantissa
+    return double(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Gets the next number of the stream mapped to a range.
+/**
+ * @param min The minimum value.
+ * @param max The maximum value.
+ * @return A uniformly distributed double in [min, max).
+ */
+double Sampler::uniform(double min, double max) {
+    return min + (max - min) * next1D();
+}
+
+// Gets the index of the next dimension.
+/**
+ * @return How many numbers have been drawn from the stream so far.
+ */
+uint32_t Sampler::getDimension() const {
+    return dimension;
+}
+
+// Starts an independent stream for one branch of the sample.
+/**
+ * The new stream depends on this stream's key, its current dimension and the
+ * branch index, so sibling branches and later forks never share numbers.
+ * @param branch The index of the branch, e.g. of a secondary ray.
+ * @return A stream starting at dimension 0.
+ */
+Sampler Sampler::fork(uint32_t branch) const {
+    Sampler child;
+    child.key = mix64(key ^ mix64(uint64_t(dimension) << 32 | branch));
+    return child;
+}
@@ -0,0 +1,29 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <cstdint>
+
+/**
+ * @class Sampler
+ * @brief Counter-based random number stream for one (pixel, sample) pair.
+ *
+ * Every number is a hash of (pixel, sample index, dimension), so there is no
+ * state shared between threads and a pixel gets the same numbers no matter
+ * which thread renders it or in what order tiles are processed.
+ */
+class Sampler {
+public:
+    Sampler() : key(0), dimension(0) {} // Default constructor, an unseeded stream.
+    Sampler(uint32_t pixelX, uint32_t pixelY, uint32_t sampleIndex, uint32_t seed = 0); // Constructor.
+
+    double next1D(); // Gets the next number in [0, 1) and advances the dimension.
+    double uniform(double min, double max); // Gets the next number in [min, max).
+    uint32_t getDimension() const; // Gets the index of the next dimension.
+    Sampler fork(uint32_t branch) const; // Starts an independent stream for one branch of the sample.
+
+private:
+    uint64_t key;       // Hash of pixel, sample index and seed.
+    uint32_t dimension; // Counter selecting the next number of the stream.
+};
+
+#endif // SAMPLER_H
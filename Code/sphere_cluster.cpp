@@ -0,0 +1,400 @@
+#include "sphere_cluster.h"
+#include "bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "cpu_dispatch.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Adds a sphere to the cluster.
+/**
+ * @param sphere The sphere; clusters hold at most maxSize of them.
+ */
+void SphereCluster::add(std::shared_ptr<Sphere> sphere) {
+    if (spheres.size() < size_t(maxSize)) {
+        spheres.push_back(sphere);
+    }
+}
+
+// Bakes the spheres and packs their centers and squared radii into the arrays.
+void SphereCluster::bake() {
+    box = AABB();
+    count = 0;
+    for (const auto& sphere : spheres) {
+        sphere->bake();
+        vec3 center = sphere->getPosition();
+        real radius = sphere->getRadius();
+        cx[count] = center.x;
+        cy[count] = center.y;
+        cz[count] = center.z;
+        radiusSquared[count] = radius * radius;
+        box.expand(sphere->bounds());
+        ++count;
+    }
+
+    // Pad to whole batches with the last sphere; a repeated sphere never wins a tie
+    while (count > 0 && count % laneCount != 0) {
+        cx[count] = cx[count - 1];
+        cy[count] = cy[count - 1];
+        cz[count] = cz[count - 1];
+        radiusSquared[count] = radiusSquared[count - 1];
+        ++count;
+    }
+}
+
+// Gets the box of all spheres.
+/**
+ * @return The baked box of the cluster.
+ */
+AABB SphereCluster::bounds() const {
+    return box;
+}
+
+// Moves every sphere of the cluster.
+/**
+ * @param transform The transform to apply.
+ */
+void SphereCluster::transform(const Matrix4& transform) {
+    for (const auto& sphere : spheres) {
+        sphere->transform(transform);
+    }
+    bake();
+}
+
+#if !defined(RT_SINGLE_PRECISION) && defined(__SSE2__)
+namespace {
+
+// Finds the sphere with the nearest root in range, four doubles at a time with AVX.
+/**
+ * Compiled for AVX whatever the build targets, and only called once the CPU
+ * was found to support it; the arithmetic is that of SphereCluster::findRoot.
+ * @param cx The center x of each sphere, padded to a multiple of four.
+ * @param cy The center y of each sphere.
+ * @param cz The center z of each sphere.
+ * @param radiusSquared The squared radius of each sphere.
+ * @param count The number of array slots in use.
+ * @param o The ray origin.
+ * @param d The ray direction.
+ * @param a The squared length of the direction.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param anyRoot If true, stops at the first batch with a root in range.
+ * @param t Receives the root of the sphere found.
+ * @return The index of the sphere, or -1 if no sphere has a root in range.
+ */
+RT_TARGET_AVX2 int findRootAvx(const real* cx, const real* cy, const real* cz, const real* radiusSquared, int count,
+                               const vec3& o, const vec3& d, real a, real t_min, real t_max, bool anyRoot, real& t) {
+    const int laneCount = 4;
+    const real infinity = std::numeric_limits<real>::infinity();
+    int best = -1;
+    t = t_max;
+    real lanes[laneCount];
+
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d signBit = _mm256_set1_pd(-0.0);
+    const __m256d ox = _mm256_set1_pd(o.x), oy = _mm256_set1_pd(o.y), oz = _mm256_set1_pd(o.z);
+    const __m256d dx = _mm256_set1_pd(d.x), dy = _mm256_set1_pd(d.y), dz = _mm256_set1_pd(d.z);
+    const __m256d va = _mm256_set1_pd(a);
+    const __m256d tMin = _mm256_set1_pd(t_min), tMax = _mm256_set1_pd(t_max);
+    const __m256d none = _mm256_set1_pd(infinity);
+
+    for (int base = 0; base < count; base += laneCount) {
+        __m256d ocx = _mm256_sub_pd(ox, _mm256_loadu_pd(cx + base));
+        __m256d ocy = _mm256_sub_pd(oy, _mm256_loadu_pd(cy + base));
+        __m256d ocz = _mm256_sub_pd(oz, _mm256_loadu_pd(cz + base));
+        __m256d b = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, dx), _mm256_mul_pd(ocy, dy)), _mm256_mul_pd(ocz, dz));
+        __m256d c = _mm256_sub_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(ocx, ocx), _mm256_mul_pd(ocy, ocy)), _mm256_mul_pd(ocz, ocz)),
+                                  _mm256_loadu_pd(radiusSquared + base));
+        __m256d discriminant = _mm256_sub_pd(_mm256_mul_pd(b, b), _mm256_mul_pd(va, c));
+        __m256d crosses = _mm256_cmp_pd(discriminant, zero, _CMP_GT_OQ);
+        if (_mm256_movemask_pd(crosses) == 0) continue;
+
+        __m256d root = _mm256_sqrt_pd(_mm256_max_pd(discriminant, zero));
+        __m256d negB = _mm256_xor_pd(b, signBit);
+        __m256d near = _mm256_div_pd(_mm256_sub_pd(negB, root), va);
+        __m256d far = _mm256_div_pd(_mm256_add_pd(negB, root), va);
+        __m256d nearIn = _mm256_and_pd(crosses, _mm256_and_pd(_mm256_cmp_pd(near, tMax, _CMP_LT_OQ), _mm256_cmp_pd(near, tMin, _CMP_GT_OQ)));
+        __m256d farIn = _mm256_and_pd(crosses, _mm256_and_pd(_mm256_cmp_pd(far, tMax, _CMP_LT_OQ), _mm256_cmp_pd(far, tMin, _CMP_GT_OQ)));
+        if (_mm256_movemask_pd(_mm256_or_pd(nearIn, farIn)) == 0) continue;
+
+        __m256d roots = _mm256_blendv_pd(_mm256_blendv_pd(none, far, farIn), near, nearIn);
+        _mm256_storeu_pd(lanes, roots);
+        for (int lane = 0; lane < laneCount; ++lane) {
+            if (lanes[lane] < t) {
+                t = lanes[lane];
+                best = base + lane;
+            }
+        }
+        if (anyRoot) return best;
+    }
+    return best;
+}
+
+const bool useAvx = activeIsa() >= Isa::AVX2; // Whether findRootAvx runs on this CPU.
+
+} // namespace
+#endif
+
+// Finds the sphere with the nearest root in range.
+/**
+ * Runs the same arithmetic as Sphere::intersect for a whole batch of spheres at once,
+ * so the roots match the single-sphere path exactly.
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param anyRoot If true, stops at the first batch with a root in range.
+ * @param t Receives the root of the sphere found.
+ * @return The index of the sphere, or -1 if no sphere has a root in range.
+ */
+int SphereCluster::findRoot(const Ray& r, real t_min, real t_max, bool anyRoot, real& t) const {
+    const real infinity = std::numeric_limits<real>::infinity();
+    vec3 o = r.getOrigin();
+    vec3 d = r.getDirection();
+    real a = vec3::dot(d, d);
+
+    int best = -1;
+    t = t_max;
+    real lanes[laneCount];
+
+#if defined(RT_SINGLE_PRECISION) && defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 ox = _mm_set1_ps(o.x), oy = _mm_set1_ps(o.y), oz = _mm_set1_ps(o.z);
+    const __m128 dx = _mm_set1_ps(d.x), dy = _mm_set1_ps(d.y), dz = _mm_set1_ps(d.z);
+    const __m128 va = _mm_set1_ps(a);
+    const __m128 tMin = _mm_set1_ps(t_min), tMax = _mm_set1_ps(t_max);
+    const __m128 none = _mm_set1_ps(infinity);
+
+    for (int base = 0; base < count; base += laneCount) {
+        __m128 ocx = _mm_sub_ps(ox, _mm_loadu_ps(cx + base));
+        __m128 ocy = _mm_sub_ps(oy, _mm_loadu_ps(cy + base));
+        __m128 ocz = _mm_sub_ps(oz, _mm_loadu_ps(cz + base));
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+        __m128 c = _mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz)),
+                              _mm_loadu_ps(radiusSquared + base));
+        __m128 discriminant = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(va, c));
+        __m128 crosses = _mm_cmpgt_ps(discriminant, zero);
+        if (_mm_movemask_ps(crosses) == 0) continue;
+
+        __m128 root = _mm_sqrt_ps(_mm_max_ps(discriminant, zero));
+        __m128 negB = _mm_xor_ps(b, signBit);
+        __m128 near = _mm_div_ps(_mm_sub_ps(negB, root), va);
+        __m128 far = _mm_div_ps(_mm_add_ps(negB, root), va);
+        __m128 nearIn = _mm_and_ps(crosses, _mm_and_ps(_mm_cmplt_ps(near, tMax), _mm_cmpgt_ps(near, tMin)));
+        __m128 farIn = _mm_and_ps(crosses, _mm_and_ps(_mm_cmplt_ps(far, tMax), _mm_cmpgt_ps(far, tMin)));
+        if (_mm_movemask_ps(_mm_or_ps(nearIn, farIn)) == 0) continue;
+
+        __m128 roots = _mm_or_ps(_mm_and_ps(farIn, far), _mm_andnot_ps(farIn, none));
+        roots = _mm_or_ps(_mm_and_ps(nearIn, near), _mm_andnot_ps(nearIn, roots));
+        _mm_storeu_ps(lanes, roots);
+        for (int lane = 0; lane < laneCount; ++lane) {
+            if (lanes[lane] < t) {
+                t = lanes[lane];
+                best = base + lane;
+            }
+        }
+        if (anyRoot) return best;
+    }
+#elif defined(__SSE2__)
+    if (useAvx) {
+        return findRootAvx(cx, cy, cz, radiusSquared, count, o, d, a, t_min, t_max, anyRoot, t);
+    }
+
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d signBit = _mm_set1_pd(-0.0);
+    const __m128d ox = _mm_set1_pd(o.x), oy = _mm_set1_pd(o.y), oz = _mm_set1_pd(o.z);
+    const __m128d dx = _mm_set1_pd(d.x), dy = _mm_set1_pd(d.y), dz = _mm_set1_pd(d.z);
+    const __m128d va = _mm_set1_pd(a);
+    const __m128d tMin = _mm_set1_pd(t_min), tMax = _mm_set1_pd(t_max);
+    const __m128d none = _mm_set1_pd(infinity);
+
+    for (int base = 0; base < count; base += 2) {
+        __m128d ocx = _mm_sub_pd(ox, _mm_loadu_pd(cx + base));
+        __m128d ocy = _mm_sub_pd(oy, _mm_loadu_pd(cy + base));
+        __m128d ocz = _mm_sub_pd(oz, _mm_loadu_pd(cz + base));
+        __m128d b = _mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, dx), _mm_mul_pd(ocy, dy)), _mm_mul_pd(ocz, dz));
+        __m128d c = _mm_sub_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(ocx, ocx), _mm_mul_pd(ocy, ocy)), _mm_mul_pd(ocz, ocz)),
+                               _mm_loadu_pd(radiusSquared + base));
+        __m128d discriminant = _mm_sub_pd(_mm_mul_pd(b, b), _mm_mul_pd(va, c));
+        __m128d crosses = _mm_cmpgt_pd(discriminant, zero);
+        if (_mm_movemask_pd(crosses) == 0) continue;
+
+        __m128d root = _mm_sqrt_pd(_mm_max_pd(discriminant, zero));
+        __m128d negB = _mm_xor_pd(b, signBit);
+        __m128d near = _mm_div_pd(_mm_sub_pd(negB, root), va);
+        __m128d far = _mm_div_pd(_mm_add_pd(negB, root), va);
+        __m128d nearIn = _mm_and_pd(crosses, _mm_and_pd(_mm_cmplt_pd(near, tMax), _mm_cmpgt_pd(near, tMin)));
+        __m128d farIn = _mm_and_pd(crosses, _mm_and_pd(_mm_cmplt_pd(far, tMax), _mm_cmpgt_pd(far, tMin)));
+        if (_mm_movemask_pd(_mm_or_pd(nearIn, farIn)) == 0) continue;
+
+        // SSE2 has no blend, so lanes are picked with masks
+        __m128d roots = _mm_or_pd(_mm_and_pd(farIn, far), _mm_andnot_pd(farIn, none));
+        roots = _mm_or_pd(_mm_and_pd(nearIn, near), _mm_andnot_pd(nearIn, roots));
+        _mm_storeu_pd(lanes, roots);
+        for (int lane = 0; lane < 2; ++lane) {
+            if (lanes[lane] < t) {
+                t = lanes[lane];
+                best = base + lane;
+            }
+        }
+        if (anyRoot) return best;
+    }
+#else
+    (void)lanes;
+    for (int i = 0; i < count; ++i) {
+        vec3 oc = o - vec3(cx[i], cy[i], cz[i]);
+        real b = vec3::dot(oc, d);
+        real c = vec3::dot(oc, oc) - radiusSquared[i];
+        real discriminant = b * b - a * c;
+        if (discriminant <= 0) continue;
+
+        real root = std::sqrt(discriminant);
+        real root0 = (-b - root) / a;
+        real root1 = (-b + root) / a;
+        real found = root0 < t_max && root0 > t_min ? root0 : (root1 < t_max && root1 > t_min ? root1 : infinity);
+        if (found < t) {
+            t = found;
+            best = i;
+            if (anyRoot) return best;
+        }
+    }
+#endif
+    return best;
+}
+
+// Finds the nearest sphere hit.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the hit distance and the index of the sphere hit.
+ * @return True if the ray hits a sphere of the cluster, false otherwise.
+ */
+bool SphereCluster::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    real t;
+    int index = findRoot(r, t_min, t_max, false, t);
+    if (index < 0) return false;
+
+    // Padding slots repeat the last sphere
+    info.t = t;
+    info.prim = std::min(index, int(spheres.size()) - 1);
+    info.depth = 0;
+    return true;
+}
+
+// Fills in the hit record from the sphere found by intersect.
+/**
+ * @param r The ray that hit the cluster.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void SphereCluster::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    spheres[info.prim]->surface(r, info, rec);
+}
+
+// Checks if any sphere of the cluster blocks a ray segment.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @return True as soon as one sphere has a root in range, false otherwise.
+ */
+bool SphereCluster::occludes(const Ray& r, real t_min, real t_max) const {
+    real t;
+    return findRoot(r, t_min, t_max, true, t) >= 0;
+}
+
+// Finds the nearest sphere hit of every ray in a packet.
+/**
+ * Here the packet fills the SIMD lanes instead of the spheres: the spheres are
+ * tested one after another against all rays, each hit shrinking the range the
+ * next sphere has to beat.
+ * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+ * @param mask The lanes to test.
+ * @param info Receives the hit distance and the index of the sphere hit of each lane.
+ * @return The bit mask of lanes that hit a sphere of the cluster.
+ */
+int SphereCluster::intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const {
+    int hits = 0;
+    RayPacket::Lanes t;
+    for (size_t i = 0; i < spheres.size(); ++i) {
+        int found = Sphere::packetRoots(packet, vec3(cx[i], cy[i], cz[i]), radiusSquared[i], t) & mask;
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if (!(found & (1 << lane))) continue;
+            info[lane].t = t[lane];
+            info[lane].prim = int(i);
+            info[lane].depth = 0;
+            packet.tMax[lane] = t[lane];
+        }
+        hits |= found;
+    }
+    return hits;
+}
+
+// Checks which rays of a packet any sphere of the cluster blocks.
+/**
+ * @param packet The rays, each with its own range.
+ * @param mask The lanes to test.
+ * @return The bit mask of lanes blocked by at least one sphere.
+ */
+int SphereCluster::occludesPacket(const RayPacket& packet, int mask) const {
+    int blocked = 0;
+    RayPacket::Lanes t;
+    for (size_t i = 0; i < spheres.size() && blocked != mask; ++i) {
+        blocked |= Sphere::packetRoots(packet, vec3(cx[i], cy[i], cz[i]), radiusSquared[i], t) & mask;
+    }
+    return blocked;
+}
+
+// Groups spheres into clusters of near neighbours.
+/**
+ * The spheres are split top-down with the same SAH partition the BVH uses, but
+ * a range is only kept whole once it fits one cluster: a SIMD batch tests a full
+ * cluster for about the price of one sphere, so the SAH leaf test would split
+ * far more than pays off here.
+ * @param spheres The spheres to group, already baked.
+ * @return The clusters, baked.
+ */
+std::vector<std::shared_ptr<SphereCluster>> SphereCluster::cluster(std::vector<std::shared_ptr<Sphere>> spheres) {
+    std::vector<AABB> sphereBounds;
+    std::vector<vec3> centroids;
+    std::vector<int> order;
+    for (size_t i = 0; i < spheres.size(); ++i) {
+        sphereBounds.push_back(spheres[i]->bounds());
+        centroids.push_back(sphereBounds.back().centroid());
+        order.push_back(int(i));
+    }
+
+    std::vector<std::shared_ptr<SphereCluster>> clusters;
+    std::vector<std::pair<int, int>> ranges; // First slot and count of each range left to split
+    if (!spheres.empty()) ranges.push_back(std::make_pair(0, int(spheres.size())));
+    while (!ranges.empty()) {
+        int first = ranges.back().first;
+        int count = ranges.back().second;
+        ranges.pop_back();
+
+        if (count <= maxSize) {
+            std::shared_ptr<SphereCluster> cluster = std::make_shared<SphereCluster>();
+            for (int i = first; i < first + count; ++i) {
+                cluster->add(spheres[order[i]]);
+            }
+            cluster->bake();
+            clusters.push_back(cluster);
+            continue;
+        }
+
+        AABB bounds;
+        for (int i = first; i < first + count; ++i) {
+            bounds.expand(sphereBounds[order[i]]);
+        }
+        int axis;
+        int mid = BVH::partition(order, first, count, bounds, sphereBounds, centroids, 1, axis);
+        ranges.push_back(std::make_pair(first, mid - first));
+        ranges.push_back(std::make_pair(mid, first + count - mid));
+    }
+    return clusters;
+}
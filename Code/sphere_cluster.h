@@ -0,0 +1,56 @@
+#ifndef SPHERE_CLUSTER_H
+#define SPHERE_CLUSTER_H
+
+#include <vector>
+#include <memory>
+#include "hittable.h"
+#include "Sphere.h"
+
+/**
+ * @class SphereCluster
+ * @brief A few nearby spheres stored as arrays and tested against a ray together.
+ *
+ * Centers and squared radii are kept one array per component, so a single ray is
+ * tested against four spheres per instruction with AVX, two with SSE2, or one at a
+ * time without either. In single precision SSE already holds four. The acceleration structure sees one object per cluster;
+ * only the sphere that is finally hit fills in the hit record.
+ */
+class SphereCluster final : public Hittable {
+public:
+    SphereCluster() : count(0) {} // Default constructor.
+
+    void add(std::shared_ptr<Sphere> sphere); // Adds a sphere, up to maxSize.
+    size_t size() const { return spheres.size(); } // Gets the number of spheres in the cluster.
+    const std::vector<std::shared_ptr<Sphere>>& getSpheres() const { return spheres; } // Gets the spheres of the cluster.
+
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Finds the nearest sphere hit.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record from the sphere hit.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if any sphere blocks a ray segment.
+    virtual int intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const override; // Finds the nearest sphere hit of every ray in a packet.
+    virtual int occludesPacket(const RayPacket& packet, int mask) const override; // Checks which rays of a packet any sphere blocks.
+    virtual void transform(const Matrix4& transform) override; // Moves every sphere of the cluster.
+    virtual void bake() override; // Bakes the spheres and packs them into the arrays.
+    virtual AABB bounds() const override; // Gets the box of all spheres.
+
+    static std::vector<std::shared_ptr<SphereCluster>> cluster(std::vector<std::shared_ptr<Sphere>> spheres); // Groups spheres into clusters of near neighbours.
+
+    static const int maxSize = 4; // Largest number of spheres in one cluster.
+#if defined(__SSE2__)
+    static const int laneCount = 4; // Spheres tested per batch; the arrays are padded to a multiple of it. Double batches take two SSE2 or one AVX instruction.
+#else
+    static const int laneCount = 1;
+#endif
+
+private:
+    int findRoot(const Ray& r, real t_min, real t_max, bool anyRoot, real& t) const; // Finds the sphere with the nearest root in range.
+
+    std::vector<std::shared_ptr<Sphere>> spheres; // The spheres, used for hit records and transforms.
+    real cx[maxSize]; // Center x of each sphere.
+    real cy[maxSize]; // Center y of each sphere.
+    real cz[maxSize]; // Center z of each sphere.
+    real radiusSquared[maxSize]; // Squared radius of each sphere.
+    int count;   // Number of array slots in use, padded by repeating the last sphere.
+    AABB box;    // Baked box of all spheres.
+};
+
+#endif // SPHERE_CLUSTER_H
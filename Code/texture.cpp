@@ -3,6 +3,80 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <map>
+#include <mutex>
+#include <cctype>
+#include <cmath>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::mutex cacheMutex; // Guards textureCache.
+std::map<std::string, std::shared_ptr<const Texture>> textureCache; // Loaded textures by file path.
+
+// Skips whitespace and '#' comments in a PPM header.
+void skipHeaderSpace(const unsigned char* data, size_t size, size_t& pos) {
+    while (pos < size) {
+        if (data[pos] == '#') {
+            while (pos < size && data[pos] != '\n') ++pos;
+        } else if (std::isspace(data[pos])) {
+            ++pos;
+        } else {
+            break;
+        }
+    }
+}
+
+// Reads a decimal number from a PPM header, returns -1 on malformed input.
+int readHeaderInt(const unsigned char* data, size_t size, size_t& pos) {
+    skipHeaderSpace(data, size, pos);
+    if (pos >= size || !std::isdigit(data[pos])) return -1;
+    int value = 0;
+    while (pos < size && std::isdigit(data[pos])) {
+        value = value * 10 + (data[pos] - '0');
+        ++pos;
+    }
+    return value;
+}
+
+} // namespace
+
+// Default constructor: creates an empty texture.
+Texture::Texture() : pixels_(nullptr), mapping_(nullptr), mappingSize_(0), width_(0), height_(0) {}
+
+// Constructor: loads a texture from a PPM file.
+/**
+ * @param texturePath The file path to the PPM texture file.
+ */
+Texture::Texture(const std::string& texturePath) : Texture() {
+    loadPPM(texturePath);
+}
+
+// Destructor: releases the pixel data.
+Texture::~Texture() {
+    unload();
+}
+
+// Releases the pixel data and any file mapping.
+void Texture::unload() {
+    #ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+    }
+    #endif
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+    pixels_ = nullptr;
+    image_.clear();
+    width_ = 0;
+    height_ = 0;
+}
 
 // Gets the color at specific texture coordinates.
 /**
@@ -11,49 +85,146 @@
  * @return The color at the specified texture coordinates as a vec3 (RGB).
  */
 vec3 Texture::getColor(float u, float v) const {
-    int x = static_cast<int>(u * width_) % width_;
-    int y = static_cast<int>(v * height_) % height_;
+    if (!pixels_) return vec3(0, 0, 0);
+
+    // Wrap coordinates outside [0, 1], including negative ones, back onto the image
+    int x = static_cast<int>(std::floor(u * width_)) % width_;
+    int y = static_cast<int>(std::floor(v * height_)) % height_;
+    if (x < 0) x += width_;
+    if (y < 0) y += height_;
 
     int index = (y * width_ + x) * 3;
-    float r = static_cast<float>(image_[index]) / 255.0f;
-    float g = static_cast<float>(image_[index + 1]) / 255.0f;
-    float b = static_cast<float>(image_[index + 2]) / 255.0f;
+    float r = static_cast<float>(pixels_[index]) / 255.0f;
+    float g = static_cast<float>(pixels_[index + 1]) / 255.0f;
+    float b = static_cast<float>(pixels_[index + 2]) / 255.0f;
 
     return vec3(r, g, b);
 }
 
+// Gets the texture width.
+/**
+ * @return The width in pixels.
+ */
+int Texture::getWidth() const {
+    return width_;
+}
+
+// Gets the texture height.
+/**
+ * @return The height in pixels.
+ */
+int Texture::getHeight() const {
+    return height_;
+}
+
 // Loads a texture from a PPM file.
 /**
+ * On POSIX systems the file is memory-mapped and the pixels are used in place;
+ * elsewhere the pixel payload is read into memory.
  * @param filename The file path to the PPM texture file.
  * @return True if the texture was successfully loaded, false otherwise.
  */
 bool Texture::loadPPM(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open()) {
+    unload();
+
+    std::vector<unsigned char> fileData;
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+    #ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
         std::cerr << "Error opening file: " << filename << std::endl;
         return false;
     }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* mapped = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            mapping_ = mapped;
+            mappingSize_ = size_t(fileStat.st_size);
+            data = static_cast<const unsigned char*>(mapped);
+            size = mappingSize_;
+        }
+    }
+    close(fd);
+    #endif
 
-    std::string format;
-    file >> format;
-    if (format != "P6") {
+    if (!data) {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Error opening file: " << filename << std::endl;
+            return false;
+        }
+        fileData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = fileData.data();
+        size = fileData.size();
+    }
+
+    // Parse the header: magic, width, height, max value, then one whitespace byte
+    size_t pos = 0;
+    if (size < 2 || data[0] != 'P' || data[1] != '6') {
         std::cerr << "Invalid PPM format. Only P6 is supported." << std::endl;
+        unload();
         return false;
     }
+    pos = 2;
+    int width = readHeaderInt(data, size, pos);
+    int height = readHeaderInt(data, size, pos);
+    int maxColor = readHeaderInt(data, size, pos);
+    ++pos;
 
-    file >> width_ >> height_;
-    int maxColor;
-    file >> maxColor;
+    size_t payloadSize = size_t(width) * size_t(height) * 3;
+    if (width <= 0 || height <= 0 || maxColor <= 0 || maxColor > 255 || pos + payloadSize > size) {
+        std::cerr << "Invalid or truncated PPM file: " << filename << std::endl;
+        unload();
+        return false;
+    }
 
-    // Ignore newline character
-    file.ignore(1);
+    width_ = width;
+    height_ = height;
+    if (mapping_) {
+        pixels_ = data + pos;
+    } else {
+        image_.assign(data + pos, data + pos + payloadSize);
+        pixels_ = image_.data();
+    }
+    return true;
+}
 
-    // Resize the image vector to hold all pixel data
-    image_.resize(width_ * height_ * 3);  // Each pixel has three color channels (RGB)
+// Gets the shared texture for a file, loading it on first use.
+/**
+ * Every caller asking for the same path receives the same immutable texture,
+ * so a texture used by many materials or primitives is loaded and stored once.
+ * A file that fails to load is not cached, so the next request tries it again.
+ * @param filename The file path to the PPM texture file.
+ * @return The shared texture, or an empty texture that reads as black if loading failed.
+ */
+std::shared_ptr<const Texture> Texture::load(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
 
-    // Read pixel data
-    file.read(reinterpret_cast<char*>(image_.data()), image_.size());
+    std::map<std::string, std::shared_ptr<const Texture>>::iterator found = textureCache.find(filename);
+    if (found != textureCache.end()) {
+        return found->second;
+    }
 
-    file.close();
-    return true;
-}
\ No newline at end of file
+    std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+    if (!texture->loadPPM(filename)) {
+        return texture;
+    }
+    textureCache[filename] = texture;
+    return texture;
+}
+
+// Drops cached textures that are no longer referenced outside the cache.
+void Texture::releaseUnused() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    for (std::map<std::string, std::shared_ptr<const Texture>>::iterator it = textureCache.begin(); it != textureCache.end();) {
+        if (it->second.use_count() == 1) {
+            it = textureCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
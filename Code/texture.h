@@ -3,24 +3,42 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include "vector.h"
 
 /**
  * @class Texture
  * @brief Represents a texture that can be applied to materials.
+ *
+ * Textures are immutable once loaded and are normally obtained through
+ * Texture::load, which shares one instance per file across the whole process.
  */
 class Texture {
 public:
-    Texture() {} // Default constructor.
-    Texture(std::string texturePath) { loadPPM(texturePath); } // Constructor that loads a texture.
+    Texture(); // Default constructor.
+    explicit Texture(const std::string& texturePath); // Constructor that loads a texture.
+    ~Texture(); // Destructor, releases the file mapping.
+
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
 
     vec3 getColor(float u, float v) const; // Gets the color at specific texture coordinates.
     bool loadPPM(const std::string& filename); // Loads a texture from a PPM file.
+    int getWidth() const; // Gets the texture width.
+    int getHeight() const; // Gets the texture height.
+
+    static std::shared_ptr<const Texture> load(const std::string& filename); // Gets the shared texture for a file.
+    static void releaseUnused(); // Drops cached textures that nothing references any more.
 
 private:
-    std::vector<unsigned char> image_; // The texture image data.
+    void unload(); // Releases the pixel data.
+
+    std::vector<unsigned char> image_; // Pixel data read into memory when the file cannot be mapped.
+    const unsigned char* pixels_;      // RGB pixel data, either mapped or in image_.
+    void* mapping_;      // Start of the mapped file, null if not mapped.
+    size_t mappingSize_; // Size of the mapped file in bytes.
     int width_;  // Texture width.
     int height_; // Texture height.
 };
 
-#endif // TEXTURE_H
\ No newline at end of file
+#endif // TEXTURE_H
@@ -0,0 +1,110 @@
+#include "tile_scheduler.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+// Spreads the lower 16 bits of v so there is a zero bit between each of them.
+uint32_t spreadBits(uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// Interleaves the bits of two tile coordinates into a Morton code.
+uint32_t mortonCode(int x, int y) {
+    return spreadBits(uint32_t(x)) | (spreadBits(uint32_t(y)) << 1);
+}
+
+} // namespace
+
+// Constructor: splits the image into tiles and deals them to the workers.
+/**
+ * @param imageWidth The image width in pixels.
+ * @param imageHeight The image height in pixels.
+ * @param tileSize The edge length of a square tile in pixels.
+ * @param numWorkers The number of render workers.
+ */
+TileScheduler::TileScheduler(int imageWidth, int imageHeight, int tileSize, int numWorkers) {
+    tileSize = std::max(1, tileSize);
+    numWorkers = std::max(1, numWorkers);
+
+    int tilesX = (imageWidth + tileSize - 1) / tileSize;
+    int tilesY = (imageHeight + tileSize - 1) / tileSize;
+
+    // Order the tiles along a Z-curve for cache-friendly traversal
+    std::vector<std::pair<uint32_t, Tile>> ordered;
+    ordered.reserve(size_t(tilesX) * size_t(tilesY));
+    for (int ty = 0; ty < tilesY; ++ty) {
+        for (int tx = 0; tx < tilesX; ++tx) {
+            Tile tile;
+            tile.x0 = tx * tileSize;
+            tile.y0 = ty * tileSize;
+            tile.x1 = std::min(imageWidth, tile.x0 + tileSize);
+            tile.y1 = std::min(imageHeight, tile.y0 + tileSize);
+            ordered.push_back(std::make_pair(mortonCode(tx, ty), tile));
+        }
+    }
+    std::sort(ordered.begin(), ordered.end(),
+              [](const std::pair<uint32_t, Tile>& a, const std::pair<uint32_t, Tile>& b) { return a.first < b.first; });
+    totalTiles = int(ordered.size());
+
+    // Give each worker one contiguous run of the curve
+    for (int w = 0; w < numWorkers; ++w) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (size_t i = 0; i < ordered.size(); ++i) {
+        int owner = int((i * size_t(numWorkers)) / ordered.size());
+        queues[owner]->tiles.push_back(ordered[i].second);
+    }
+}
+
+// Gets the total number of tiles.
+/**
+ * @return The number of tiles the image was split into.
+ */
+int TileScheduler::tileCount() const {
+    return totalTiles;
+}
+
+// Gets the next tile for a worker.
+/**
+ * @param worker The index of the calling worker.
+ * @param tile Receives the tile to render.
+ * @return True if a tile was handed out, false once all tiles are taken.
+ */
+bool TileScheduler::next(int worker, Tile& tile) {
+    WorkerQueue& own = *queues[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tiles.empty()) {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            return true;
+        }
+    }
+    return steal(worker, tile);
+}
+
+// Takes a tile from the back of another worker's queue.
+/**
+ * @param thief The index of the worker looking for work.
+ * @param tile Receives the stolen tile.
+ * @return True if a tile was stolen, false if every queue is empty.
+ */
+bool TileScheduler::steal(int thief, Tile& tile) {
+    int numWorkers = int(queues.size());
+    for (int offset = 1; offset < numWorkers; ++offset) {
+        WorkerQueue& victim = *queues[(thief + offset) % numWorkers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty()) {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,50 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+
+/**
+ * @struct Tile
+ * @brief A rectangular block of pixels, [x0, x1) by [y0, y1).
+ */
+struct Tile {
+    int x0, y0; ///< Top-left pixel of the tile (inclusive).
+    int x1, y1; ///< Bottom-right pixel of the tile (exclusive).
+};
+
+/**
+ * @class TileScheduler
+ * @brief Hands out image tiles to render workers, with work stealing between workers.
+ *
+ * Tiles are laid out in Morton (Z-curve) order so consecutive tiles are spatially
+ * close, then dealt to the workers in contiguous runs. A worker takes tiles from
+ * the front of its own queue and, once that is empty, steals from the back of
+ * another worker's queue, so no core idles while expensive tiles remain.
+ */
+class TileScheduler {
+public:
+    TileScheduler(int imageWidth, int imageHeight, int tileSize, int numWorkers); // Constructor.
+
+    bool next(int worker, Tile& tile); // Gets the next tile for a worker.
+    int tileCount() const; // Gets the total number of tiles.
+
+private:
+    /**
+     * @struct WorkerQueue
+     * @brief The tiles still owned by one worker.
+     */
+    struct WorkerQueue {
+        std::mutex mutex;       ///< Guards tiles.
+        std::deque<Tile> tiles; ///< Remaining tiles of the worker.
+    };
+
+    bool steal(int thief, Tile& tile); // Takes a tile from another worker.
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // One queue per worker.
+    int totalTiles; // Number of tiles in the image.
+};
+
+#endif // TILE_SCHEDULER_H
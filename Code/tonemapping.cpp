@@ -1,9 +1,10 @@
 #include "tonemapping.h"
+#include "cpu_dispatch.h"
 
 
 
-// Function to perform Reinhard tone mapping on an image
-void toneMapReinhard(std::vector<Pixel>& image, int width, int height, float key) {
+// Reinhard tone mapping, compiled once per instruction set level below
+static RT_ALWAYS_INLINE void reinhardKernel(std::vector<Pixel>& image, int width, int height, float key) {
     // Calculate luminance and adapt the exposure
     float sum = 0.0f;
     for (const auto& pixel : image) {
@@ -20,6 +21,14 @@ void toneMapReinhard(std::vector<Pixel>& image, int width, int height, float key
     }
 }
 
+RT_ISA_VARIANTS(void, reinhard, (std::vector<Pixel>& image, int width, int height, float key),
+                (image, width, height, key))
+
+// Function to perform Reinhard tone mapping on an image, with the widest vector instructions the CPU offers
+void toneMapReinhard(std::vector<Pixel>& image, int width, int height, float key) {
+    reinhard(image, width, height, key);
+}
+
 // Function to read a PPM file
 void readPPM(const std::string& filename, std::vector<Pixel>& image, int& width, int& height) {
     std::ifstream file(filename);
@@ -1,3 +1,6 @@
+#ifndef TONEMAPPING_H
+#define TONEMAPPING_H
+
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -11,4 +14,6 @@ struct Pixel {
 
 void toneMapReinhard(std::vector<Pixel>& image, int width, int height, float key);
 void readPPM(const std::string& filename, std::vector<Pixel>& image, int& width, int& height);
-void writePPM(const std::string& filename, const std::vector<Pixel>& image, int width, int height);
\ No newline at end of file
+void writePPM(const std::string& filename, const std::vector<Pixel>& image, int width, int height);
+
+#endif // TONEMAPPING_H
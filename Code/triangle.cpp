@@ -1,4 +1,5 @@
 #include "triangle.h"
+#include "cpu_dispatch.h"
 
 // Checks for a grid-based intersection with the triangle.
 /**
@@ -8,164 +9,165 @@
  * @param rec The record to store hit information.
  * @return True if the ray intersects the grid, false otherwise.
  */
-bool Triangle::gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    double t0 = std::numeric_limits<double>::lowest();
-    double t1 = std::numeric_limits<double>::max();
-    if (!hitBoundingBox(r, t0, t1))
-        return false;
-
-    t0 = std::max(t0, t_min);
-    t1 = std::min(t1, t_max);
-
-    if (t0 >= t1)
-        return false;
+bool Triangle::gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    // The baked box test already clips against the valid range
+    return hitBoundingBox(r, t_min, t_max);
+}
 
-    return true;
+// Checks for a ray-bounding box intersection.
+/**
+ * @param r The ray to test.
+ * @param t0 The minimum t value for a valid hit.
+ * @param t1 The maximum t value for a valid hit.
+ * @return True if the ray intersects the baked bounding box, false otherwise.
+ */
+bool Triangle::hitBoundingBox(const Ray& r, real t0, real t1) const {
+    vec3 d = r.getDirection();
+    return box.hit(r.getOrigin(), vec3(1.0 / d.x, 1.0 / d.y, 1.0 / d.z), t0, t1);
 }
 
-// Computes the distance between two points.
+// Moves the three vertices.
 /**
- * @param p1 The first point.
- * @param p2 The second point.
- * @return The distance between the two points.
+ * Texture coordinates are re-derived from the moved vertices by bake().
+ * @param transform The transform to apply.
  */
-double distance(const vec3& p1, const vec3& p2) {
-    return std::sqrt((p1.x - p2.x) * (p1.x - p2.x) +
-                     (p1.y - p2.y) * (p1.y - p2.y) +
-                     (p1.z - p2.z) * (p1.z - p2.z));
+void Triangle::transform(const Matrix4& transform) {
+    v0 = transform.transformPoint(v0);
+    v1 = transform.transformPoint(v1);
+    v2 = transform.transformPoint(v2);
+    bake();
 }
 
-// Computes the area of a triangle given its side lengths.
+// Precomputes the data used by the intersection routines.
+void Triangle::bake() {
+    edge1 = v1 - v0;
+    edge2 = v2 - v0;
+    faceNormal = vec3::cross(edge1, edge2).return_unit();
+    calculateTextureCoordinates();
+
+    box = AABB();
+    box.expand(v0);
+    box.expand(v1);
+    box.expand(v2);
+}
+
+// Gets the bounding box of the triangle.
 /**
- * @param a The length of the first side.
- * @param b The length of the second side.
- * @param c The length of the third side.
- * @return The area of the triangle.
+ * @return The baked box spanning the three vertices.
  */
-double area(double a, double b, double c) {
-    double s = (a + b + c) / 2;
-    return std::sqrt(s * (s - a) * (s - b) * (s - c));
+AABB Triangle::bounds() const {
+    return box;
 }
 
-// Checks for a ray-bounding box intersection.
+// Checks for a ray-triangle intersection using the Möller–Trumbore algorithm.
 /**
  * @param r The ray to test.
- * @param t0 The minimum t value for a valid hit.
- * @param t1 The maximum t value for a valid hit.
- * @return True if the ray intersects the bounding box, false otherwise.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param info Receives the hit distance and the barycentrics of the hit point.
+ * @return True if the ray intersects the triangle, false otherwise.
  */
-bool Triangle::hitBoundingBox(const Ray& r, double t0, double t1) const {
-    double a = distance(v0, v2);
-    double b = distance(v1, v2);
-    double c = distance(v1, v0);
+bool Triangle::intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const {
+    if (!hitBoundingBox(r, t_min, t_max)) return false;
 
-    double K = area(a, b, c);
-    double R = (a * b * c) / (4 * K);
+    const real EPSILON = 1e-6;
 
-    vec3 center;
-    center.x = (v0.x + v1.x + v2.x) / 3;
-    center.y = (v0.y + v1.y + v2.y) / 3;
-    center.z = (v0.z + v1.z + v2.z) / 3;
+    vec3 h = vec3::cross(r.getDirection(), edge2);
+    real a = vec3::dot(edge1, h);
 
-    double radius = R;
+    if (a > -EPSILON && a < EPSILON)
+        return false;
 
-    vec3 center_min = center - vec3(radius, radius, radius);
-    vec3 center_max = center + vec3(radius, radius, radius);
+    real f = 1.0 / a;
+    vec3 s = r.getOrigin() - v0;
+    real u = f * vec3::dot(s, h);
 
-    double center_min_arr[] = {center_min.x, center_min.y, center_min.z};
-    double center_max_arr[] = {center_max.x, center_max.y, center_max.z};
-    vec3 ray_direction = r.getDirection();
-    double ray_direction_arr[] = {ray_direction.x, ray_direction.y, ray_direction.z};
-    vec3 ray_origin = r.getOrigin();
-    double ray_origin_arr[] = {ray_origin.x, ray_origin.y, ray_origin.z};
+    if (u < 0.0 || u > 1.0)
+        return false;
 
-    for (int i = 0; i < 3; ++i) {
-        double invD = 1.0 / (0.0001 + ray_direction_arr[i]);
-        double tNear = (center_min_arr[i] - ray_origin_arr[i]) * invD;
-        double tFar = (center_max_arr[i] - ray_origin_arr[i]) * invD;
+    vec3 q = vec3::cross(s, edge1);
+    real v = f * vec3::dot(r.getDirection(), q);
 
-        if (invD < 0.0)
-            std::swap(tNear, tFar);
+    if (v < 0.0 || u + v > 1.0)
+        return false;
 
-        t0 = tNear > t0 ? tNear : t0;
-        t1 = tFar < t1 ? tFar : t1;
+    real t = f * vec3::dot(edge2, q);
 
-        if (t0 >= t1)
-            return false;
+    if (t > t_min && t < t_max) {
+        info.t = t;
+        info.u = u;
+        info.v = v;
+        info.depth = 0;
+        return true;
     }
 
-    return true;
+    return false;
 }
 
-// Checks for a ray-triangle intersection using the Möller–Trumbore algorithm.
+// Fills in the hit record from the barycentrics found by intersect.
+/**
+ * @param r The ray that hit the triangle.
+ * @param info The hit found by intersect.
+ * @param rec The record to store hit information.
+ */
+void Triangle::surface(const Ray& r, const HitInfo& info, HitRecord& rec) const {
+    rec.materialId = materialId;
+    rec.textured = textureIsSet;
+    rec.t = info.t;
+    rec.p = r.pointAtParameter(rec.t);
+    rec.normal = faceNormal;
+
+    if (textureIsSet) {
+        real u = info.u, v = info.v;
+        real temp_u = u0 * (1 - u - v) + u1 * u + u2 * v;
+        real temp_v = v0_coord * (1 - u - v) + v1_coord * u + v2_coord * v;
+        rec.textureColor = texture->getColor(temp_u, temp_v);
+    }
+}
+
+// Checks if the triangle blocks a ray segment.
 /**
+ * Runs the Möller–Trumbore test without computing the hit point, normal or texture.
  * @param r The ray to test.
  * @param t_min The minimum t value for a valid hit.
  * @param t_max The maximum t value for a valid hit.
- * @param rec The record to store hit information.
- * @return True if the ray intersects the triangle, false otherwise.
+ * @return True if the ray crosses the triangle within [t_min, t_max], false otherwise.
  */
-bool Triangle::hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const {
-    if (!gridHit(r, t_min, t_max, rec)) return false;
-
-    const double EPSILON = 1e-6;
+bool Triangle::occludes(const Ray& r, real t_min, real t_max) const {
+    const real EPSILON = 1e-6;
 
-    vec3 edge1 = v1 - v0;
-    vec3 edge2 = v2 - v0;
     vec3 h = vec3::cross(r.getDirection(), edge2);
-    double a = vec3::dot(edge1, h);
+    real a = vec3::dot(edge1, h);
 
     if (a > -EPSILON && a < EPSILON)
         return false;
 
-    double f = 1.0 / a;
+    real f = 1.0 / a;
     vec3 s = r.getOrigin() - v0;
-    double u = f * vec3::dot(s, h);
+    real u = f * vec3::dot(s, h);
 
     if (u < 0.0 || u > 1.0)
         return false;
 
     vec3 q = vec3::cross(s, edge1);
-    double v = f * vec3::dot(r.getDirection(), q);
+    real v = f * vec3::dot(r.getDirection(), q);
 
     if (v < 0.0 || u + v > 1.0)
         return false;
 
-    double t = f * vec3::dot(edge2, q);
-
-    if (t > t_min && t < t_max) {
-        rec.material = this->material;
-        rec.t = t;
-        rec.p = r.pointAtParameter(rec.t);
-        rec.normal = vec3::cross(edge1, edge2).return_unit();
-
-        if (textureIsSet) {
-            double temp_u = u0 * (1 - u - v) + u1 * u + u2 * v;
-            double temp_v = v0_coord * (1 - u - v) + v1_coord * u + v2_coord * v;
-            rec.material.setDiffuseColor(material.getTexture(temp_u, temp_v));
-        }
-        rec.normal.return_unit();
-        return true;
-    }
-
-    return false;
+    real t = f * vec3::dot(edge2, q);
+    return t > t_min && t < t_max;
 }
 
 // Sets the material of the triangle.
 /**
- * @param material The material to set.
+ * @param materialId The index of the material in the world's material table.
+ * @param material The material itself, used to pick up its shared texture.
  */
-void Triangle::setMaterial(Material material) {
-    this->material = material;
-}
-
-// Sets the texture of the triangle.
-/**
- * @param texturePath The file path to the texture.
- */
-void Triangle::setTexture(const std::string& texturePath) {
-    this->material.setTexture(texturePath);
-    this->textureIsSet = true;
+void Triangle::setMaterial(int materialId, const Material& material) {
+    this->materialId = materialId;
+    this->texture = material.getTextureHandle();
+    this->textureIsSet = material.hasTexture();
 }
 
 // Calculates texture coordinates for the triangle.
@@ -176,4 +178,95 @@ void Triangle::calculateTextureCoordinates() {
     v1_coord = v1.y;
     u2 = v2.x;
     v2_coord = v2.y;
-}
\ No newline at end of file
+}
+
+namespace {
+
+// Packet triangle test, compiled once per instruction set level below.
+RT_ALWAYS_INLINE int triangleHitsKernel(const RayPacket& packet, const vec3& v0, const vec3& edge1, const vec3& edge2,
+                                        RayPacket::Lanes& t, RayPacket::Lanes& u, RayPacket::Lanes& v) {
+    typedef RayPacket::Lanes Lanes;
+    typedef RayPacket::LaneMask LaneMask;
+    const real EPSILON = 1e-6;
+
+    Lanes hx = packet.dy * edge2.z - packet.dz * edge2.y;
+    Lanes hy = packet.dz * edge2.x - packet.dx * edge2.z;
+    Lanes hz = packet.dx * edge2.y - packet.dy * edge2.x;
+    Lanes a = edge1.x * hx + edge1.y * hy + edge1.z * hz;
+    LaneMask parallel = (a > -EPSILON) & (a < EPSILON);
+
+    Lanes f = real(1.0) / a;
+    Lanes sx = packet.ox - v0.x;
+    Lanes sy = packet.oy - v0.y;
+    Lanes sz = packet.oz - v0.z;
+    u = f * (sx * hx + sy * hy + sz * hz);
+    LaneMask outside = (u < real(0.0)) | (u > real(1.0));
+
+    Lanes qx = sy * edge1.z - sz * edge1.y;
+    Lanes qy = sz * edge1.x - sx * edge1.z;
+    Lanes qz = sx * edge1.y - sy * edge1.x;
+    v = f * (packet.dx * qx + packet.dy * qy + packet.dz * qz);
+    outside |= (v < real(0.0)) | (u + v > real(1.0));
+
+    t = f * (edge2.x * qx + edge2.y * qy + edge2.z * qz);
+    LaneMask inRange = (t > packet.tMin) & (t < packet.tMax);
+    return RayPacket::bits(~parallel & ~outside & inRange);
+}
+
+RT_ISA_VARIANTS(int, triangleHits,
+                (const RayPacket& packet, const vec3& v0, const vec3& edge1, const vec3& edge2,
+                 RayPacket::Lanes& t, RayPacket::Lanes& u, RayPacket::Lanes& v),
+                (packet, v0, edge1, edge2, t, u, v))
+
+} // namespace
+
+// Runs the ray-triangle test on every lane of a packet.
+/**
+ * Same Moller-Trumbore arithmetic as Triangle::occludes, in the same order, so each
+ * lane agrees with the single-ray test. The lanes are processed with the widest
+ * vector instructions the CPU offers.
+ * @param packet The rays, each with its own range.
+ * @param t Receives the hit distance of each lane.
+ * @param u Receives the first barycentric coordinate of each lane.
+ * @param v Receives the second barycentric coordinate of each lane.
+ * @return The bit mask of lanes that hit the triangle within their range.
+ */
+int Triangle::packetHits(const RayPacket& packet, RayPacket::Lanes& t, RayPacket::Lanes& u, RayPacket::Lanes& v) const {
+    return triangleHits(packet, v0, edge1, edge2, t, u, v);
+}
+
+// Finds where the rays of a packet hit the triangle.
+/**
+ * Lanes are box-tested first, as Triangle::intersect does.
+ * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+ * @param mask The lanes to test.
+ * @param info Receives the hit distance and barycentrics of each lane that hits.
+ * @return The bit mask of lanes that hit the triangle.
+ */
+int Triangle::intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const {
+    mask &= packet.hitsBox(box);
+    if (!mask) return 0;
+
+    RayPacket::Lanes t, u, v;
+    int hits = packetHits(packet, t, u, v) & mask;
+    for (int lane = 0; lane < RayPacket::size; ++lane) {
+        if (!(hits & (1 << lane))) continue;
+        info[lane].t = t[lane];
+        info[lane].u = u[lane];
+        info[lane].v = v[lane];
+        info[lane].depth = 0;
+        packet.tMax[lane] = t[lane];
+    }
+    return hits;
+}
+
+// Checks which rays of a packet the triangle blocks.
+/**
+ * @param packet The rays, each with its own range.
+ * @param mask The lanes to test.
+ * @return The bit mask of lanes the triangle blocks.
+ */
+int Triangle::occludesPacket(const RayPacket& packet, int mask) const {
+    RayPacket::Lanes t, u, v;
+    return packetHits(packet, t, u, v) & mask;
+}
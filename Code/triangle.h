@@ -8,25 +8,36 @@
  * @class Triangle
  * @brief Represents a triangle that can be hit by rays.
  */
-class Triangle : public Hittable {
+class Triangle final : public Hittable {
 public:
-    Triangle() {} // Default constructor.
-    Triangle(const vec3& v0, const vec3& v1, const vec3& v2) : v0(v0), v1(v1), v2(v2), textureIsSet(false) {} // Constructor.
+    Triangle() : materialId(0), textureIsSet(false) {} // Default constructor.
+    Triangle(const vec3& v0, const vec3& v1, const vec3& v2) : v0(v0), v1(v1), v2(v2), materialId(0), textureIsSet(false) {} // Constructor.
 
-    void setMaterial(Material material); // Sets the triangle's material.
-    void setTexture(const std::string& texturePath); // Sets the triangle's texture.
-    bool gridHit(const Ray& r, double t_min, double t_max, HitRecord& rec) const; // Grid-based intersection check.
-    bool hitBoundingBox(const Ray& r, double t0, double t1) const; // Checks for ray-bounding box intersection.
+    void setMaterial(int materialId, const Material& material); // Sets the triangle's material from the world's material table.
+    bool gridHit(const Ray& r, real t_min, real t_max, HitRecord& rec) const; // Grid-based intersection check.
+    bool hitBoundingBox(const Ray& r, real t0, real t1) const; // Checks for ray-bounding box intersection.
 
-    virtual bool hit(const Ray& r, double t_min, double t_max, HitRecord& rec) const override; // Checks for ray-triangle intersection.
+    virtual bool intersect(const Ray& r, real t_min, real t_max, HitInfo& info) const override; // Checks for ray-triangle intersection.
+    virtual void surface(const Ray& r, const HitInfo& info, HitRecord& rec) const override; // Fills in the hit record from the barycentrics.
+    virtual bool occludes(const Ray& r, real t_min, real t_max) const override; // Checks if the triangle blocks a ray segment.
+    virtual int intersectPacket(RayPacket& packet, int mask, HitInfo info[]) const override; // Tests every ray of a packet at once.
+    virtual int occludesPacket(const RayPacket& packet, int mask) const override; // Checks which rays of a packet the triangle blocks.
+    virtual void transform(const Matrix4& transform) override; // Moves the three vertices.
+    virtual void bake() override; // Precomputes the edges, face normal, texture coordinates and bounding box.
+    virtual AABB bounds() const override; // Gets the triangle's bounding box.
 
 private:
     vec3 v0, v1, v2;       // Triangle vertices.
-    Material material;     // Triangle material.
-    double u0, v0_coord, u1, v1_coord, u2, v2_coord; // Texture coordinates.
+    vec3 edge1, edge2;     // Baked edges from v0 to v1 and v0 to v2.
+    vec3 faceNormal;       // Baked unit face normal.
+    AABB box;              // Baked bounding box.
+    int materialId;       // Index into the world's material table.
+    std::shared_ptr<const Texture> texture; // Shared texture of the material, null if untextured.
+    real u0, v0_coord, u1, v1_coord, u2, v2_coord; // Texture coordinates.
     bool textureIsSet;     // Texture flag.
 
     void calculateTextureCoordinates(); // Calculates texture coordinates.
+    int packetHits(const RayPacket& packet, RayPacket::Lanes& t, RayPacket::Lanes& u, RayPacket::Lanes& v) const; // Runs the ray-triangle test on every lane.
 };
 
 #endif // TRIANGLE_H
\ No newline at end of file
@@ -2,41 +2,105 @@
 #define VEC_H
 
 #include <cmath>
+#include <cstdio>
 
 /**
- * @class vec3
+ * @brief Floating-point type of geometry, rays and hit records.
+ *
+ * Double by default. Building with RT_SINGLE_PRECISION defined (make PRECISION=float)
+ * switches to float, which halves the size of rays and primitives and fits twice as
+ * many values in a SIMD register, at the cost of accuracy on large scenes.
+ */
+#ifdef RT_SINGLE_PRECISION
+typedef float real;
+#else
+typedef double real;
+#endif
+
+/**
+ * @class basic_vec3
  * @brief Represents a 3D vector with utility functions.
+ *
+ * Everything is defined in this header so that vector arithmetic inlines into the
+ * intersection loops. The operators are friends defined in the class, so mixing a
+ * vector with a scalar of another floating-point type converts the scalar instead
+ * of failing to deduce T.
  */
-class vec3 {
+template <typename T>
+class basic_vec3 {
 public:
-    double x, y, z; ///< Vector components.
+    T x, y, z; ///< Vector components.
+
+    basic_vec3() : x(0), y(0), z(0) {} // Default constructor.
+    basic_vec3(T x, T y, T z) : x(x), y(y), z(z) {} // Parameterized constructor.
+
+    T length() const { return std::sqrt(x * x + y * y + z * z); } // Returns the vector's magnitude.
+    T length_squared() const { return x * x + y * y + z * z; } // Returns the squared magnitude.
+    T operator[](int axis) const { return axis == 0 ? x : (axis == 1 ? y : z); } // Component access by axis index (0 = x, 1 = y, 2 = z).
+
+    // Normalizes the vector; a zero vector is left as it is.
+    void normalize() {
+        T len = length();
+        if (len != 0) {
+            x /= len;
+            y /= len;
+            z /= len;
+        }
+    }
+
+    // Returns a unit vector in the same direction; a zero vector stays zero.
+    basic_vec3 return_unit() const {
+        T len = length();
+        if (len == 0) return basic_vec3();
+        return basic_vec3(x / len, y / len, z / len);
+    }
+
+    // Prints the vector.
+    static void printVector(const basic_vec3& a) {
+        printf("\tx = %f\n,", double(a.x));
+        printf("\t\t\ty = %f\n,", double(a.y));
+        printf("\t\t\tz = %f\n\n,", double(a.z));
+    }
+
+    static T dot(const basic_vec3& a, const basic_vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; } // Dot product.
+
+    // Cross product.
+    static basic_vec3 cross(const basic_vec3& a, const basic_vec3& b) {
+        return basic_vec3(a.y * b.z - a.z * b.y,
+                          a.z * b.x - a.x * b.z,
+                          a.x * b.y - a.y * b.x);
+    }
 
-    vec3(); // Default constructor.
-    vec3(double x, double y, double z); // Parameterized constructor.
+    basic_vec3& operator+=(const basic_vec3& other) { x += other.x; y += other.y; z += other.z; return *this; } // Adds another vector.
+    basic_vec3& operator-=(const basic_vec3& other) { x -= other.x; y -= other.y; z -= other.z; return *this; } // Subtracts another vector.
+    basic_vec3& operator*=(T scalar) { x *= scalar; y *= scalar; z *= scalar; return *this; } // Multiplies by a scalar.
 
-    double length() const; // Returns the vector's magnitude.
-    double length_squared() const; // Returns the squared magnitude.
-    void normalize(); // Normalizes the vector.
-    vec3 return_unit(); // Returns a unit vector.
+    // Divides by a scalar; dividing by zero leaves the vector unchanged.
+    basic_vec3& operator/=(T scalar) {
+        if (scalar != 0) {
+            x /= scalar;
+            y /= scalar;
+            z /= scalar;
+        }
+        return *this;
+    }
 
-    static void printVector(const vec3& a); // Prints the vector.
-    static double dot(const vec3& a, const vec3& b); // Dot product.
-    static vec3 cross(const vec3& a, const vec3& b); // Cross product.
-    static vec3 random(double min, double max); // Generates a random vector.
+    friend basic_vec3 operator+(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(a.x + b.x, a.y + b.y, a.z + b.z); } // Vector addition.
+    friend basic_vec3 operator-(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(a.x - b.x, a.y - b.y, a.z - b.z); } // Vector subtraction.
+    friend basic_vec3 operator*(const basic_vec3& v, T scalar) { return basic_vec3(v.x * scalar, v.y * scalar, v.z * scalar); } // Scalar multiplication.
+    friend basic_vec3 operator*(const basic_vec3& a, const basic_vec3& b) { return basic_vec3(a.x * b.x, a.y * b.y, a.z * b.z); } // Component-wise multiplication.
+    friend basic_vec3 operator*(T scalar, const basic_vec3& v) { return v * scalar; } // Scalar multiplication.
+    friend basic_vec3 operator-(const basic_vec3& v) { return basic_vec3(-v.x, -v.y, -v.z); } // Negates the vector.
 
-    vec3& operator+=(const vec3& other); // Adds another vector.
-    vec3& operator-=(const vec3& other); // Subtracts another vector.
-    vec3& operator*=(double scalar); // Multiplies by a scalar.
-    vec3& operator/=(double scalar); // Divides by a scalar.
+    // Scalar division; dividing by zero returns the vector unchanged.
+    friend basic_vec3 operator/(const basic_vec3& v, T scalar) {
+        if (scalar != 0) {
+            return basic_vec3(v.x / scalar, v.y / scalar, v.z / scalar);
+        }
+        return v;
+    }
 };
 
-// Vector operators
-vec3 operator+(const vec3& a, const vec3& b); // Vector addition.
-vec3 operator-(const vec3& a, const vec3& b); // Vector subtraction.
-vec3 operator*(const vec3& v, double scalar); // Scalar multiplication.
-vec3 operator*(const vec3& a, const vec3& b); // Component-wise multiplication.
-vec3 operator*(double scalar, const vec3& v); // Scalar multiplication.
-vec3 operator/(const vec3& v, double scalar); // Scalar division.
-vec3 operator-(const vec3& v); // Negates the vector.
+typedef basic_vec3<real> vec3; ///< The vector type used throughout the renderer.
 
-#endif // VEC_H
\ No newline at end of file
+#endif // VEC_H
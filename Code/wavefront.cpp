@@ -0,0 +1,274 @@
+#include "wavefront.h"
+#include "world.h"
+#include "Material.h"
+#include <algorithm>
+
+namespace {
+
+// Spreads the lower 10 bits of v so there are two zero bits between each of them.
+uint32_t spreadBits3(uint32_t v) {
+    v &= 0x000003ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+// Quantizes a coordinate to one of 1024 cells along an axis.
+uint32_t cellIndex(real value, real lo, real extent) {
+    if (extent <= 0) return 0;
+    real cell = (value - lo) / extent * 1023;
+    return uint32_t(std::min<real>(1023, std::max<real>(0, cell)));
+}
+
+} // namespace
+
+// Constructor: Creates an empty renderer for a world.
+/**
+ * @param world The scene to render; its queries are called from the rendering thread.
+ */
+Wavefront::Wavefront(World& world) : world(world), sortRays(true) {}
+
+// Turns sorting of secondary waves on or off.
+/**
+ * @param sortRays True to sort every wave after the camera rays, false to trace waves in the order they were spawned.
+ */
+void Wavefront::setRaySorting(bool sortRays) {
+    this->sortRays = sortRays;
+}
+
+// Removes the camera rays and results of the last batch.
+void Wavefront::clear() {
+    colors.clear();
+    hits.clear();
+    wave.clear();
+}
+
+// Adds a camera ray to the batch.
+/**
+ * @param r The camera ray.
+ * @param sampler The random stream of the pixel sample, after the camera has drawn from it.
+ * @return The root index under which the ray's results are read back.
+ */
+int Wavefront::addCameraRay(const Ray& r, const Sampler& sampler) {
+    WaveRay w;
+    w.ray = r;
+    w.weight = vec3(1, 1, 1);
+    w.parentNormal = vec3(0, 0, 0);
+    w.sampler = sampler;
+    w.root = int(colors.size());
+    w.budgetDepth = -1;
+    w.kind = Shade;
+    wave.push_back(w);
+    colors.push_back(vec3(0, 0, 0));
+    hits.push_back(0);
+    return w.root;
+}
+
+// Traces the batch until no rays are left.
+/**
+ * Binary mode only needs the camera wave. The other modes alternate between
+ * intersecting the whole wave and shading its hits one material bin at a time.
+ * @param mode How hits are turned into colours.
+ */
+void Wavefront::trace(RenderMode mode) {
+    for (size_t i = 0; i < wave.size(); ++i) {
+        wave[i].kind = mode == RenderMode::Path ? Path : Shade;
+    }
+
+    bool cameraWave = true;
+    while (!wave.empty()) {
+        // Camera rays are already in image order, which is as coherent as it gets
+        if (sortRays && !cameraWave) {
+            sortWave();
+        }
+        cameraWave = false;
+
+        intersect(mode);
+        if (mode == RenderMode::Binary) {
+            wave.clear();
+            break;
+        }
+
+        binByMaterial();
+        nextWave.clear();
+        for (size_t k = 0; k < order.size(); ++k) {
+            WaveRay& w = wave[order[k]];
+            const HitRecord& rec = records[order[k]];
+            if (w.kind != Path) {
+                shadePhong(w, rec);
+                continue;
+            }
+            if (world.scatterPath(w.ray, rec, w.sampler, w.weight, colors[w.root]) &&
+                w.ray.getDepth() < World::maxPathLength) {
+                nextWave.push_back(w);
+            }
+        }
+        wave.swap(nextWave);
+    }
+}
+
+// Intersects every ray of the current wave.
+/**
+ * @param mode Binary mode only asks whether anything is hit.
+ */
+void Wavefront::intersect(RenderMode mode) {
+    records.resize(wave.size());
+    found.assign(wave.size(), 0);
+    for (size_t i = 0; i < wave.size(); ++i) {
+        const WaveRay& w = wave[i];
+        if (mode == RenderMode::Binary) {
+            if (world.anyHit(w.ray)) hits[w.root] = 1;
+            continue;
+        }
+        found[i] = world.closestHit(w.ray, records[i]);
+        if (found[i] && w.ray.getDepth() == 0) {
+            hits[w.root] = 1;
+        }
+    }
+}
+
+// Orders the hits of the current wave by material.
+/**
+ * A counting sort into one bin per material id, keeping the wave order inside
+ * each bin, so every bin shades the same material and texture back to back.
+ */
+void Wavefront::binByMaterial() {
+    int materialCount = 0;
+    for (size_t i = 0; i < wave.size(); ++i) {
+        if (found[i]) materialCount = std::max(materialCount, records[i].materialId + 1);
+    }
+
+    binStart.assign(materialCount + 1, 0);
+    for (size_t i = 0; i < wave.size(); ++i) {
+        if (found[i]) ++binStart[records[i].materialId + 1];
+    }
+    for (int m = 0; m < materialCount; ++m) {
+        binStart[m + 1] += binStart[m];
+    }
+
+    order.resize(binStart[materialCount]);
+    for (size_t i = 0; i < wave.size(); ++i) {
+        if (found[i]) order[binStart[records[i].materialId]++] = int(i);
+    }
+}
+
+// Shades one Phong hit and queues the secondary rays it spawns.
+/**
+ * Mirrors World::shade, except that the reflected colours are not summed here:
+ * each secondary ray carries the factor its colour is weighted with in the
+ * parent, and adds its own contribution to the camera ray once it hits.
+ * @param w The ray that was hit.
+ * @param rec The hit.
+ */
+void Wavefront::shadePhong(WaveRay& w, const HitRecord& rec) {
+    vec3 weight = w.weight;
+    if (w.ray.getDepth() > 0) {
+        weight = weight * std::max<double>(0.0, vec3::dot(w.parentNormal, (-1) * rec.normal));
+    }
+
+    // The recursive shader only reads the diffuse colour where these rays land
+    if (w.kind == Fetch) {
+        colors[w.root] += weight * world.diffuseColorAt(rec);
+        return;
+    }
+
+    colors[w.root] += weight * (world.diffuseColorAt(rec) + world.phongLights(rec));
+
+    int depth = w.ray.getDepth();
+    if (depth >= world.getMaxBounces()) return;
+
+    const Material& material = world.getMaterial(rec.materialId);
+    int budgetDepth = w.budgetDepth < 0 ? depth : w.budgetDepth;
+    int numSamples = world.phongSampleCount(material, budgetDepth);
+    bool deltaLobe = material.getIsreflective() && material.getReflectivity() >= 1.0f;
+    vec3 lobeWeight = weight * material.getSpecularColor();
+
+    for (int i = 0; i < numSamples; ++i) {
+        WaveRay child;
+        child.ray = world.compute_reflected_ray(w.ray, rec);
+        child.parentNormal = rec.normal;
+        child.sampler = w.sampler.fork(uint32_t(i));
+        child.root = w.root;
+        child.budgetDepth = -1;
+        child.kind = Shade;
+
+        if (deltaLobe) {
+            // A mirror bounce passes its sample budget on to the surface it reaches
+            child.weight = lobeWeight;
+            child.budgetDepth = budgetDepth;
+            nextWave.push_back(child);
+            continue;
+        }
+
+        vec3 sampledDirection = world.randomUnitVector(rec.normal, w.sampler);
+        child.weight = (1.0 / numSamples) * lobeWeight;
+        if (material.getIsreflective()) {
+            child.ray.setDirection(material.getReflectivity() * child.ray.getDirection() + (1.0 - material.getReflectivity()) * sampledDirection);
+        }
+        else {
+            child.ray.setDirection(sampledDirection);
+            child.kind = Fetch;
+        }
+        nextWave.push_back(child);
+    }
+}
+
+// Sorts the current wave by direction octant and origin cell.
+/**
+ * The key is the octant of the direction above the Morton code of the origin
+ * in a 1024^3 grid over the origins of the wave. The ray index breaks ties,
+ * so rays with equal keys keep their order whatever the sort implementation.
+ */
+void Wavefront::sortWave() {
+    // The index shares a word with the key, which keeps the sort to plain integers
+    const int indexBits = 24;
+    const uint64_t indexMask = (uint64_t(1) << indexBits) - 1;
+    if (wave.size() < 2 || wave.size() > indexMask) return;
+
+    vec3 lo = wave[0].ray.getOrigin();
+    vec3 hi = lo;
+    for (size_t i = 1; i < wave.size(); ++i) {
+        const vec3& o = wave[i].ray.getOrigin();
+        lo = vec3(std::min(lo.x, o.x), std::min(lo.y, o.y), std::min(lo.z, o.z));
+        hi = vec3(std::max(hi.x, o.x), std::max(hi.y, o.y), std::max(hi.z, o.z));
+    }
+    vec3 extent = hi - lo;
+
+    keys.resize(wave.size());
+    for (size_t i = 0; i < wave.size(); ++i) {
+        const vec3& o = wave[i].ray.getOrigin();
+        const vec3& d = wave[i].ray.getDirection();
+        uint64_t octant = (d.x < 0 ? 1 : 0) | (d.y < 0 ? 2 : 0) | (d.z < 0 ? 4 : 0);
+        uint32_t cell = spreadBits3(cellIndex(o.x, lo.x, extent.x)) |
+                        spreadBits3(cellIndex(o.y, lo.y, extent.y)) << 1 |
+                        spreadBits3(cellIndex(o.z, lo.z, extent.z)) << 2;
+        keys[i] = (octant << 30 | cell) << indexBits | i;
+    }
+    std::sort(keys.begin(), keys.end());
+
+    nextWave.clear();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        nextWave.push_back(wave[keys[i] & indexMask]);
+    }
+    wave.swap(nextWave);
+}
+
+// Checks if a camera ray hit anything.
+/**
+ * @param root The index returned by addCameraRay.
+ * @return True if the camera ray hit an object.
+ */
+bool Wavefront::hit(int root) const {
+    return hits[root] != 0;
+}
+
+// Gets the colour gathered by a camera ray.
+/**
+ * @param root The index returned by addCameraRay.
+ * @return The shaded colour or path radiance; black in binary mode.
+ */
+const vec3& Wavefront::getColor(int root) const {
+    return colors[root];
+}
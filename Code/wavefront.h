@@ -0,0 +1,87 @@
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include <vector>
+#include <cstdint>
+#include "vector.h"
+#include "Ray.h"
+#include "hittable.h"
+#include "sampler.h"
+#include "Camera.h"
+
+class World;
+
+/**
+ * @class Wavefront
+ * @brief Breadth-first renderer that traces every ray of a bounce as one stream.
+ *
+ * The recursive shader follows each sample depth-first, so consecutive rays
+ * wander through unrelated parts of the scene. Here all camera rays of a batch
+ * are intersected first, the hits are binned by material and shaded bin by bin,
+ * and the secondary rays they spawn form the next wave. Before each later wave is
+ * intersected it is sorted by direction octant and by the Morton code of the ray
+ * origin, so neighbouring rays in the stream walk the same nodes and primitives.
+ *
+ * Each camera ray is the root of its own tree of rays; what the tree gathers is
+ * summed per root and read back once the batch is done. Path tracing follows the
+ * same per-sample random stream as World::tracePath and gives the same image. The
+ * Phong shader forks a stream per secondary ray instead of sharing one depth-first,
+ * so its noise differs from the recursive shader's.
+ */
+class Wavefront {
+public:
+    explicit Wavefront(World& world); // Constructor.
+
+    void setRaySorting(bool sortRays); // Turns sorting of secondary waves on or off.
+    void clear(); // Removes the camera rays and results of the last batch.
+    int addCameraRay(const Ray& r, const Sampler& sampler); // Adds a camera ray to the batch and returns its root index.
+    void trace(RenderMode mode); // Traces the batch until no rays are left.
+    bool hit(int root) const; // Checks if a camera ray hit anything.
+    const vec3& getColor(int root) const; // Gets the colour gathered by a camera ray.
+
+    static const int batchSize = 4096; // Preferred number of camera rays per batch.
+
+private:
+    /**
+     * @enum RayKind
+     * @brief What the hit of a wave ray is used for.
+     */
+    enum RayKind {
+        Shade, ///< Phong: the hit is fully shaded and may spawn more rays.
+        Fetch, ///< Phong: only the diffuse colour at the hit is used.
+        Path   ///< Path tracing: the next vertex of a path.
+    };
+
+    /**
+     * @struct WaveRay
+     * @brief One ray of a wave together with the state of the sample it belongs to.
+     */
+    struct WaveRay {
+        Ray ray;           ///< The ray itself; its depth is the bounce count.
+        vec3 weight;       ///< Factor on everything the ray gathers; the throughput of a path.
+        vec3 parentNormal; ///< Phong: normal of the surface that spawned the ray.
+        Sampler sampler;   ///< Random stream of the ray.
+        int root;          ///< Index of the camera ray the ray descends from.
+        int budgetDepth;   ///< Phong: depth whose sample budget to use, or -1 to use the ray depth.
+        RayKind kind;      ///< What the hit is used for.
+    };
+
+    void intersect(RenderMode mode); // Intersects the current wave.
+    void binByMaterial(); // Orders the hits of the current wave by material.
+    void shadePhong(WaveRay& w, const HitRecord& rec); // Shades one Phong hit and queues its secondary rays.
+    void sortWave(); // Sorts the next wave by direction octant and origin cell.
+
+    World& world;                   // The scene being rendered.
+    bool sortRays;                  // Sort secondary waves before intersecting them.
+    std::vector<vec3> colors;       // Colour gathered per camera ray.
+    std::vector<char> hits;         // Whether each camera ray hit anything.
+    std::vector<WaveRay> wave;      // Rays of the current bounce.
+    std::vector<WaveRay> nextWave;  // Rays spawned for the next bounce.
+    std::vector<HitRecord> records; // Hit of each ray of the current wave.
+    std::vector<char> found;        // Whether each ray of the current wave hit.
+    std::vector<int> order;         // Rays of the current wave that hit, grouped by material.
+    std::vector<int> binStart;      // Start of each material's bin in order, one extra at the end.
+    std::vector<uint64_t> keys;     // Sort key of each ray of the wave, above its index.
+};
+
+#endif // WAVEFRONT_H
@@ -0,0 +1,321 @@
+#include "wide_bvh.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double traversalCost = 1.0;    // Relative cost of visiting an inner node.
+const double intersectionCost = 1.0; // Relative cost of one primitive test.
+
+} // namespace
+
+const double WideBVH::rebuildThreshold = 1.5;
+
+// Builds a binary BVH over the primitive boxes and collapses it into wide nodes.
+/**
+ * @param primBounds The bounding box of each primitive.
+ * @param maxLeafSize The largest number of primitives a leaf may hold.
+ */
+void WideBVH::build(const std::vector<AABB>& primBounds, int maxLeafSize) {
+    nodes.clear();
+    primIndices.clear();
+
+    BVH binary;
+    binary.build(primBounds, maxLeafSize);
+    if (binary.empty()) return;
+
+    primIndices = binary.getPrimIndices();
+    nodes.reserve(binary.getNodes().size() / 2 + 1);
+    collapse(binary, 0);
+    builtCost = cost = refit(primBounds);
+}
+
+// Recomputes all node boxes after primitives moved, keeping the tree topology.
+/**
+ * Each node is visited once, children before parents, so the cost is linear in
+ * the number of nodes and primitives.
+ * @param primBounds The new bounding box of each primitive, indexed as at build time.
+ * @return The SAH cost of the refitted tree.
+ */
+double WideBVH::refit(const std::vector<AABB>& primBounds) {
+    if (nodes.empty()) return cost = 0;
+
+    double areaCost = 0;
+    AABB root = refitNode(0, primBounds, areaCost);
+    double rootArea = root.surfaceArea();
+    cost = traversalCost + (rootArea > 0 ? areaCost / rootArea : 0);
+    return cost;
+}
+
+// Checks if refitting has degraded the tree past the rebuild threshold.
+/**
+ * Refitted boxes grow and overlap as primitives drift from where the tree was
+ * built, which shows up as a rising SAH cost.
+ * @return True if the cost grew by more than the threshold since the last build.
+ */
+bool WideBVH::needsRebuild() const {
+    return cost > builtCost * rebuildThreshold;
+}
+
+// Refits a subtree bottom-up.
+/**
+ * @param index The wide node at the root of the subtree.
+ * @param primBounds The bounding box of each primitive.
+ * @param areaCost Accumulates the area-weighted SAH cost of the subtree's children.
+ * @return The exact box of the subtree.
+ */
+AABB WideBVH::refitNode(int index, const std::vector<AABB>& primBounds, double& areaCost) {
+    AABB childBounds[WideBVHNode::width];
+    AABB box;
+    int childCount = nodes[index].childCount;
+    for (int i = 0; i < childCount; ++i) {
+        int child = nodes[index].child[i];
+        int count = nodes[index].count[i];
+        if (count > 0) {
+            for (int j = child; j < child + count; ++j)
+                childBounds[i].expand(primBounds[primIndices[j]]);
+            areaCost += intersectionCost * count * childBounds[i].surfaceArea();
+        } else {
+            childBounds[i] = refitNode(child, primBounds, areaCost);
+            areaCost += traversalCost * childBounds[i].surfaceArea();
+        }
+        box.expand(childBounds[i]);
+    }
+    quantize(nodes[index], childBounds);
+    return box;
+}
+
+// Turns a binary subtree into wide nodes.
+/**
+ * The node starts with the two children of the binary node; the inner child with
+ * the largest surface area is then replaced by its own children until four slots
+ * are used or only leaves remain.
+ * @param binary The binary BVH being collapsed.
+ * @param binaryIndex The binary node at the root of the subtree.
+ * @return The index of the wide node created for the subtree.
+ */
+int WideBVH::collapse(const BVH& binary, int binaryIndex) {
+    const std::vector<BVHNode>& binaryNodes = binary.getNodes();
+
+    int children[WideBVHNode::width];
+    int childCount = 0;
+    const BVHNode& start = binaryNodes[binaryIndex];
+    if (start.isLeaf()) {
+        children[childCount++] = binaryIndex;
+    } else {
+        children[childCount++] = start.leftFirst;
+        children[childCount++] = start.leftFirst + 1;
+        while (childCount < WideBVHNode::width) {
+            int best = -1;
+            double bestArea = -1;
+            for (int i = 0; i < childCount; ++i) {
+                const BVHNode& candidate = binaryNodes[children[i]];
+                if (!candidate.isLeaf() && candidate.bounds.surfaceArea() > bestArea) {
+                    bestArea = candidate.bounds.surfaceArea();
+                    best = i;
+                }
+            }
+            if (best < 0) break;
+
+            int opened = children[best];
+            children[best] = binaryNodes[opened].leftFirst;
+            children[childCount++] = binaryNodes[opened].leftFirst + 1;
+        }
+    }
+
+    int index = int(nodes.size());
+    nodes.push_back(WideBVHNode());
+
+    AABB childBounds[WideBVHNode::width];
+    for (int i = 0; i < childCount; ++i) {
+        const BVHNode& binaryChild = binaryNodes[children[i]];
+        childBounds[i] = binaryChild.bounds;
+
+        // Recursing may grow the node array, so the node is looked up again each time
+        int child = binaryChild.isLeaf() ? binaryChild.leftFirst : collapse(binary, children[i]);
+        nodes[index].child[i] = child;
+        nodes[index].count[i] = binaryChild.isLeaf() ? binaryChild.count : 0;
+    }
+    for (int i = childCount; i < WideBVHNode::width; ++i) {
+        nodes[index].child[i] = 0;
+        nodes[index].count[i] = 0;
+    }
+    nodes[index].childCount = childCount;
+    quantize(nodes[index], childBounds);
+    return index;
+}
+
+// Stores child boxes relative to the node box with 8 bits per bound.
+/**
+ * The node origin is rounded down and the step size up, and every quantized bound
+ * is then checked against the exact box using the same float operations the
+ * traversal uses, so a dequantized child box always contains the real one.
+ * @param node The node to fill; its childCount must be set.
+ * @param childBounds The exact box of each child.
+ */
+void WideBVH::quantize(WideBVHNode& node, const AABB* childBounds) {
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    AABB box;
+    for (int i = 0; i < node.childCount; ++i) {
+        if (!childBounds[i].isEmpty()) box.expand(childBounds[i]);
+    }
+
+    for (int axis = 0; axis < 3; ++axis) {
+        float origin = 0.0f;
+        float scale = 1.0f;
+        if (!box.isEmpty()) {
+            double lo = box.min[axis];
+            double hi = box.max[axis];
+
+            origin = float(lo);
+            if (double(origin) > lo) origin = std::nextafter(origin, -infinity);
+
+            scale = std::nextafter(float((hi - origin) / 255.0), infinity);
+            scale = std::max(scale, std::abs(origin) * 1e-6f + 1e-30f);
+            while (double(origin + 255.0f * scale) < hi) scale *= 1.0001f;
+        }
+        node.origin[axis] = origin;
+        node.scale[axis] = scale;
+
+        for (int i = 0; i < WideBVHNode::width; ++i) {
+            if (i >= node.childCount || childBounds[i].isEmpty()) {
+                node.lo[axis][i] = 0;
+                node.hi[axis][i] = 0;
+                continue;
+            }
+
+            double childLo = childBounds[i].min[axis];
+            double childHi = childBounds[i].max[axis];
+
+            int qLo = int(std::floor((childLo - origin) / scale));
+            qLo = std::max(0, std::min(255, qLo));
+            while (qLo > 0 && double(origin + float(qLo) * scale) > childLo) --qLo;
+
+            int qHi = int(std::ceil((childHi - origin) / scale));
+            qHi = std::max(0, std::min(255, qHi));
+            while (qHi < 255 && double(origin + float(qHi) * scale) < childHi) ++qHi;
+
+            node.lo[axis][i] = uint8_t(qLo);
+            node.hi[axis][i] = uint8_t(qHi);
+        }
+    }
+}
+
+// Builds the wide BVH over the world's objects.
+/**
+ * @param objects The objects to index.
+ */
+void BVHAccelerator::build(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    std::vector<AABB> primBounds;
+    primBounds.reserve(objects.size());
+    for (const auto& object : objects) {
+        primBounds.push_back(object->bounds());
+    }
+    bvh.build(primBounds);
+    prims.build(objects, bvh.getPrimIndices());
+}
+
+// Refits the wide BVH after objects moved, or rebuilds it once refits degrade it.
+/**
+ * @param objects The same objects, in the same order, as passed to build.
+ */
+void BVHAccelerator::update(const std::vector<std::shared_ptr<Hittable>>& objects) {
+    if (objects.size() != prims.size()) {
+        build(objects);
+        return;
+    }
+
+    std::vector<AABB> primBounds;
+    primBounds.reserve(objects.size());
+    for (const auto& object : objects) {
+        primBounds.push_back(object->bounds());
+    }
+
+    bvh.refit(primBounds);
+    if (bvh.needsRebuild()) {
+        bvh.build(primBounds);
+    }
+    prims.build(objects, bvh.getPrimIndices());
+}
+
+// Finds the closest intersection by walking the wide BVH.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param rec The record to store hit information.
+ * @return True if the ray hits an object, false otherwise.
+ */
+bool BVHAccelerator::hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const {
+    HitInfo info;
+    int closest = -1;
+    bool found = bvh.closestHit(r, t_min, t_max, [&](int prim, real tMin, real& tMax) {
+        if (prims.intersect(prim, r, tMin, tMax, info)) {
+            tMax = info.t;
+            closest = prim;
+            return true;
+        }
+        return false;
+    });
+    if (!found) return false;
+
+    prims.surface(closest, r, info, rec);
+    return true;
+}
+
+
+// Checks if any object blocks a ray segment by walking the wide BVH.
+/**
+ * @param r The ray to test.
+ * @param t_min The minimum t value for a valid hit.
+ * @param t_max The maximum t value for a valid hit.
+ * @param blocker If not null, receives the object that blocked the ray.
+ * @return True as soon as one object blocks the segment, false otherwise.
+ */
+bool BVHAccelerator::occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker) const {
+    return bvh.anyHit(r, t_min, t_max, [&](int prim) {
+        if (prims.occludes(prim, r, t_min, t_max)) {
+            if (blocker) *blocker = prims.get(prim);
+            return true;
+        }
+        return false;
+    });
+}
+
+// Finds the closest intersections of a packet by walking the wide BVH once.
+/**
+ * Primitives are tested against all rays that reach their leaf at once, and
+ * hit records are only filled in for each ray's final hit.
+ * @param packet The rays; the range of every ray that hits is shrunk to its closest hit.
+ * @param rec Receives the hit record of each lane that hits, indexed by lane.
+ * @return The bit mask of lanes that hit an object.
+ */
+int BVHAccelerator::hitPacket(RayPacket& packet, HitRecord rec[]) const {
+    HitInfo info[RayPacket::size];
+    int closest[RayPacket::size];
+    int hits = bvh.closestHitPacket(packet, [&](int prim, int mask) {
+        int hit = prims.intersectPacket(prim, packet, mask, info);
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if (hit & (1 << lane)) closest[lane] = prim;
+        }
+        return hit;
+    });
+
+    for (int lane = 0; lane < RayPacket::size; ++lane) {
+        if (hits & (1 << lane))
+            prims.surface(closest[lane], packet.ray(lane), info[lane], rec[lane]);
+    }
+    return hits;
+}
+
+// Checks which rays of a packet are blocked by walking the wide BVH once.
+/**
+ * @param packet The rays, each with its own range.
+ * @return The bit mask of lanes whose segment is blocked.
+ */
+int BVHAccelerator::occludedPacket(const RayPacket& packet) const {
+    return bvh.anyHitPacket(packet, [&](int prim, int mask) {
+        return prims.occludesPacket(prim, packet, mask);
+    });
+}
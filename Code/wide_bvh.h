@@ -0,0 +1,618 @@
+#ifndef WIDE_BVH_H
+#define WIDE_BVH_H
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "bvh.h"
+#include "accelerator.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @struct WideBVHNode
+ * @brief A node with up to four children whose boxes are tested together.
+ *
+ * Child boxes are stored relative to the node's own box, quantized to 8 bits per
+ * bound and laid out axis by axis, so one node fits in 80 bytes and the four slab
+ * tests of an axis are one SIMD operation. Quantization always rounds outwards, so
+ * a child box can only grow, never cut off a primitive.
+ */
+struct WideBVHNode {
+    static const int width = 4; ///< Maximum number of children.
+
+    float origin[3];        ///< Minimum corner of the node box, rounded down.
+    float scale[3];         ///< Size of one quantization step along each axis.
+    uint8_t lo[3][width];   ///< Quantized minimum of each child, per axis.
+    uint8_t hi[3][width];   ///< Quantized maximum of each child, per axis.
+    int child[width];       ///< Node index of an inner child, first primitive slot of a leaf child.
+    int count[width];       ///< Number of primitives of a leaf child, 0 for an inner child.
+    int childCount;         ///< Number of children in use; they fill the first slots.
+};
+
+/**
+ * @class WideBVH
+ * @brief Four-wide BVH collapsed from a binary BVH, with SIMD child tests.
+ *
+ * The binary builder decides the tree; collapsing merges every inner node with its
+ * largest children until it has four, which halves the depth and turns four
+ * scattered box tests into one node fetch and one vector test. The same primitive
+ * callbacks as BVH::closestHit and BVH::anyHit are used, so the two are
+ * interchangeable. Without SSE2 the child test runs as a scalar loop.
+ */
+class WideBVH {
+public:
+    WideBVH() {} // Default constructor.
+
+    void build(const std::vector<AABB>& primBounds, int maxLeafSize = 4); // Builds a binary BVH and collapses it.
+    double refit(const std::vector<AABB>& primBounds); // Recomputes all node boxes for moved primitives and returns the new SAH cost.
+    bool needsRebuild() const; // Checks if refitting has degraded the tree past the rebuild threshold.
+    bool empty() const { return nodes.empty(); } // Checks if the hierarchy has been built.
+    double getCost() const { return cost; } // Gets the SAH cost of the current tree.
+    const std::vector<WideBVHNode>& getNodes() const { return nodes; } // Gets the node array.
+    const std::vector<int>& getPrimIndices() const { return primIndices; } // Gets the leaf primitive order.
+
+    /**
+     * @brief Walks the hierarchy and reports the closest primitive hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim, real t_min, real& t_max) that tests one
+     *                primitive and shrinks t_max on a hit.
+     * @return True if any primitive was hit, false otherwise.
+     */
+    template <typename PrimHit>
+    bool closestHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (nodes.empty()) return false;
+        return closestHitFrom(RayData(r), StackEntry(0, 0, float(t_min)), t_min, t_max, primHit);
+    }
+
+    /**
+     * @brief Walks the hierarchy until any primitive reports a hit.
+     * @param r The ray to test.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim) that tests one primitive against [t_min, t_max].
+     * @return True as soon as a primitive is hit, false if none is.
+     */
+    template <typename PrimHit>
+    bool anyHit(const Ray& r, real t_min, real t_max, PrimHit primHit) const {
+        if (nodes.empty()) return false;
+        return anyHitFrom(RayData(r), StackEntry(0, 0, float(t_min)), t_min, t_max, primHit);
+    }
+
+    /**
+     * @brief Walks the hierarchy once for a whole packet and reports each ray's closest hit.
+     * Children are visited by every ray of the packet that overlaps them, nearest
+     * first; a child that no ray of the packet can reach is dropped by a single
+     * frustum test before any per-ray test runs.
+     * @param packet The rays; the range of every ray that hits is shrunk to its closest hit.
+     * @param primHit Callable int(int prim, int mask) that tests one primitive against the
+     *                lanes in mask, shrinks their ranges on a hit and returns the lanes hit.
+     * @return The bit mask of lanes that hit any primitive.
+     */
+    template <typename PrimHit>
+    int closestHitPacket(RayPacket& packet, PrimHit primHit) const {
+        if (nodes.empty() || !packet.activeMask()) return 0;
+
+        PacketData rays(packet);
+        int hits = 0;
+        PacketEntry stack[stackSize];
+        int top = 0;
+        stack[top++] = PacketEntry(0, 0, packet.activeMask(), float(packet.tMin));
+
+        while (top > 0) {
+            PacketEntry entry = stack[--top];
+            if (entry.t > maxRange(packet, entry.mask)) continue;
+
+            // A ray left on its own finishes the subtree with the single-ray walk
+            if (!(entry.mask & (entry.mask - 1))) {
+                int lane = __builtin_ctz(entry.mask);
+                real tMax = packet.tMax[lane];
+                bool found = closestHitFrom(rays.rays[lane], StackEntry(entry.index, entry.count, entry.t), packet.tMin, tMax,
+                                            [&](int prim, real, real& laneMax) {
+                    bool hit = primHit(prim, entry.mask) != 0;
+                    laneMax = packet.tMax[lane];
+                    return hit;
+                });
+                if (found) hits |= entry.mask;
+                continue;
+            }
+
+            if (entry.count > 0) {
+                for (int i = entry.index; i < entry.index + entry.count; ++i) {
+                    hits |= primHit(primIndices[i], entry.mask);
+                }
+                continue;
+            }
+
+            const WideBVHNode& node = nodes[entry.index];
+            int childMask[WideBVHNode::width];
+            float tEnter[WideBVHNode::width];
+            intersectChildren(node, rays, packet, entry.mask, childMask, tEnter);
+
+            int order[WideBVHNode::width];
+            int visits = 0;
+            for (int i = 0; i < node.childCount; ++i) {
+                if (!childMask[i]) continue;
+                int j = visits++;
+                while (j > 0 && tEnter[order[j - 1]] < tEnter[i]) {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = i;
+            }
+            for (int k = 0; k < visits; ++k) {
+                int i = order[k];
+                stack[top++] = PacketEntry(node.child[i], node.count[i], childMask[i], tEnter[i]);
+            }
+        }
+        return hits;
+    }
+
+    /**
+     * @brief Walks the hierarchy once for a whole packet until every ray is blocked or done.
+     * @param packet The rays, each with its own range.
+     * @param primHit Callable int(int prim, int mask) that returns the lanes in mask the
+     *                primitive blocks.
+     * @return The bit mask of lanes that are blocked.
+     */
+    template <typename PrimHit>
+    int anyHitPacket(const RayPacket& packet, PrimHit primHit) const {
+        int active = packet.activeMask();
+        if (nodes.empty() || !active) return 0;
+
+        PacketData rays(packet);
+        int blocked = 0;
+        PacketEntry stack[stackSize];
+        int top = 0;
+        stack[top++] = PacketEntry(0, 0, active, float(packet.tMin));
+
+        while (top > 0 && blocked != active) {
+            PacketEntry entry = stack[--top];
+            entry.mask &= ~blocked;
+            if (!entry.mask) continue;
+
+            if (!(entry.mask & (entry.mask - 1))) {
+                int lane = __builtin_ctz(entry.mask);
+                if (anyHitFrom(rays.rays[lane], StackEntry(entry.index, entry.count, entry.t), packet.tMin, packet.tMax[lane],
+                               [&](int prim) { return primHit(prim, entry.mask) != 0; }))
+                    blocked |= entry.mask;
+                continue;
+            }
+
+            if (entry.count > 0) {
+                for (int i = entry.index; i < entry.index + entry.count && entry.mask; ++i) {
+                    int found = primHit(primIndices[i], entry.mask);
+                    blocked |= found;
+                    entry.mask &= ~found;
+                }
+                continue;
+            }
+
+            const WideBVHNode& node = nodes[entry.index];
+            int childMask[WideBVHNode::width];
+            float tEnter[WideBVHNode::width];
+            intersectChildren(node, rays, packet, entry.mask, childMask, tEnter);
+            for (int i = 0; i < node.childCount; ++i) {
+                if (childMask[i])
+                    stack[top++] = PacketEntry(node.child[i], node.count[i], childMask[i], tEnter[i]);
+            }
+        }
+        return blocked;
+    }
+
+private:
+    /**
+     * @struct RayData
+     * @brief Single-precision copy of the ray used by the child tests.
+     */
+    struct RayData {
+        float origin[3];
+        float invDirection[3];
+
+        RayData() {}
+
+        explicit RayData(const Ray& r) {
+            vec3 o = r.getOrigin();
+            vec3 d = r.getDirection();
+            for (int axis = 0; axis < 3; ++axis) {
+                origin[axis] = float(o[axis]);
+                invDirection[axis] = float(1.0 / d[axis]);
+            }
+        }
+    };
+
+    /**
+     * @struct StackEntry
+     * @brief A pending inner node or leaf range, with the distance at which the ray enters it.
+     */
+    struct StackEntry {
+        int index;   // Node index, or first primitive slot of a leaf.
+        int count;   // Number of primitives of a leaf, 0 for a node.
+        float t;     // Entry distance along the ray.
+
+        StackEntry() {} // Left uninitialized, so a traversal stack costs nothing to set up.
+        StackEntry(int index, int count, float t) : index(index), count(count), t(t) {}
+    };
+
+    static const int stackSize = (WideBVHNode::width - 1) * (BVH::maxDepth + 1) + 1; // Deepest possible stack.
+
+    typedef float ChildFloats __attribute__((vector_size(WideBVHNode::width * sizeof(float))));  // One value per child.
+    typedef int32_t ChildInts __attribute__((vector_size(WideBVHNode::width * sizeof(float))));  // Integer or comparison result per child.
+
+    /**
+     * @struct ChildBounds
+     * @brief The child boxes of a node, expanded from their quantized form.
+     */
+    struct ChildBounds {
+        ChildFloats lo[3]; // Minimum of each child, per axis.
+        ChildFloats hi[3]; // Maximum of each child, per axis.
+
+        explicit ChildBounds(const WideBVHNode& node) {
+#if defined(__SSE2__)
+            __m128i zero = _mm_setzero_si128();
+            for (int axis = 0; axis < 3; ++axis) {
+                int loBits, hiBits;
+                std::memcpy(&loBits, node.lo[axis], sizeof(int));
+                std::memcpy(&hiBits, node.hi[axis], sizeof(int));
+                __m128 loSteps = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(loBits), zero), zero));
+                __m128 hiSteps = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(hiBits), zero), zero));
+                __m128 origin = _mm_set1_ps(node.origin[axis]);
+                __m128 scale = _mm_set1_ps(node.scale[axis]);
+                lo[axis] = _mm_add_ps(origin, _mm_mul_ps(loSteps, scale));
+                hi[axis] = _mm_add_ps(origin, _mm_mul_ps(hiSteps, scale));
+            }
+#else
+            for (int axis = 0; axis < 3; ++axis) {
+                for (int i = 0; i < WideBVHNode::width; ++i) {
+                    lo[axis][i] = node.origin[axis] + float(node.lo[axis][i]) * node.scale[axis];
+                    hi[axis][i] = node.origin[axis] + float(node.hi[axis][i]) * node.scale[axis];
+                }
+            }
+#endif
+        }
+    };
+
+    /**
+     * @brief Slab-tests a ray against all children of a node.
+     * @param node The node whose children to test.
+     * @param ray The ray in single precision.
+     * @param tMin The minimum t value for a valid hit.
+     * @param tMax The maximum t value for a valid hit.
+     * @param tEnter Receives the entry distance of every child.
+     * @return A bit mask of the children the ray overlaps.
+     */
+    static int intersectChildren(const WideBVHNode& node, const RayData& ray, float tMin, float tMax, float tEnter[]) {
+        return intersectChildren(ChildBounds(node), node.childCount, ray, tMin, tMax, tEnter);
+    }
+
+    /**
+     * @brief Slab-tests a ray against child boxes that have already been expanded.
+     * @param bounds The child boxes.
+     * @param childCount The number of children in use.
+     * @param ray The ray in single precision.
+     * @param tMin The minimum t value for a valid hit.
+     * @param tMax The maximum t value for a valid hit.
+     * @param tEnter Receives the entry distance of every child.
+     * @return A bit mask of the children the ray overlaps.
+     */
+    static int intersectChildren(const ChildBounds& bounds, int childCount, const RayData& ray, float tMin, float tMax, float tEnter[]) {
+        // Widen the exit distance slightly so single-precision rounding never culls a grazing hit
+        const float exitScale = 1.0000004f;
+        int valid = (1 << childCount) - 1;
+
+#if defined(__SSE2__)
+        __m128 enter = _mm_set1_ps(tMin);
+        __m128 exit = _mm_set1_ps(tMax);
+        for (int axis = 0; axis < 3; ++axis) {
+            __m128 rayOrigin = _mm_set1_ps(ray.origin[axis]);
+            __m128 invDirection = _mm_set1_ps(ray.invDirection[axis]);
+
+            __m128 t0 = _mm_mul_ps(_mm_sub_ps(bounds.lo[axis], rayOrigin), invDirection);
+            __m128 t1 = _mm_mul_ps(_mm_sub_ps(bounds.hi[axis], rayOrigin), invDirection);
+
+            // A NaN from a ray lying in a slab plane leaves the running interval unchanged
+            enter = _mm_max_ps(_mm_min_ps(t0, t1), enter);
+            exit = _mm_min_ps(_mm_max_ps(t0, t1), exit);
+        }
+        exit = _mm_mul_ps(exit, _mm_set1_ps(exitScale));
+        _mm_storeu_ps(tEnter, enter);
+        return _mm_movemask_ps(_mm_cmple_ps(enter, exit)) & valid;
+#else
+        int mask = 0;
+        for (int i = 0; i < childCount; ++i) {
+            float enter = tMin;
+            float exit = tMax;
+            for (int axis = 0; axis < 3; ++axis) {
+                float t0 = (bounds.lo[axis][i] - ray.origin[axis]) * ray.invDirection[axis];
+                float t1 = (bounds.hi[axis][i] - ray.origin[axis]) * ray.invDirection[axis];
+                float tNear = t0 < t1 ? t0 : t1;
+                float tFar = t0 < t1 ? t1 : t0;
+                enter = tNear > enter ? tNear : enter;
+                exit = tFar < exit ? tFar : exit;
+            }
+            tEnter[i] = enter;
+            if (enter <= exit * exitScale) mask |= 1 << i;
+        }
+        return mask & valid;
+#endif
+    }
+
+    /**
+     * @brief Walks a subtree and reports the closest primitive hit, as closestHit does from the root.
+     * @param ray The ray in single precision.
+     * @param start The node or leaf range to start from.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit, shrunk to the closest hit.
+     * @param primHit Callable bool(int prim, real t_min, real& t_max), as for closestHit.
+     * @return True if any primitive was hit, false otherwise.
+     */
+    template <typename PrimHit>
+    bool closestHitFrom(const RayData& ray, StackEntry start, real t_min, real& t_max, PrimHit primHit) const {
+        bool hit_anything = false;
+        StackEntry stack[stackSize];
+        int top = 0;
+        stack[top++] = start;
+
+        while (top > 0) {
+            StackEntry entry = stack[--top];
+            if (entry.t > t_max) continue;
+
+            if (entry.count > 0) {
+                for (int i = entry.index; i < entry.index + entry.count; ++i) {
+                    if (primHit(primIndices[i], t_min, t_max))
+                        hit_anything = true;
+                }
+                continue;
+            }
+
+            const WideBVHNode& node = nodes[entry.index];
+            float tEnter[WideBVHNode::width];
+            int mask = intersectChildren(node, ray, float(t_min), float(t_max), tEnter);
+
+            // Push the hit children far to near, so the nearest is visited next
+            int order[WideBVHNode::width];
+            int hits = 0;
+            for (int i = 0; i < node.childCount; ++i) {
+                if (!(mask & (1 << i))) continue;
+                int j = hits++;
+                while (j > 0 && tEnter[order[j - 1]] < tEnter[i]) {
+                    order[j] = order[j - 1];
+                    --j;
+                }
+                order[j] = i;
+            }
+            for (int k = 0; k < hits; ++k) {
+                int i = order[k];
+                stack[top++] = StackEntry(node.child[i], node.count[i], tEnter[i]);
+            }
+        }
+        return hit_anything;
+    }
+
+    /**
+     * @brief Walks a subtree until any primitive reports a hit, as anyHit does from the root.
+     * @param ray The ray in single precision.
+     * @param start The node or leaf range to start from.
+     * @param t_min The minimum t value for a valid hit.
+     * @param t_max The maximum t value for a valid hit.
+     * @param primHit Callable bool(int prim), as for anyHit.
+     * @return True as soon as a primitive is hit, false if none is.
+     */
+    template <typename PrimHit>
+    bool anyHitFrom(const RayData& ray, StackEntry start, real t_min, real t_max, PrimHit primHit) const {
+        StackEntry stack[stackSize];
+        int top = 0;
+        stack[top++] = start;
+
+        while (top > 0) {
+            StackEntry entry = stack[--top];
+
+            if (entry.count > 0) {
+                for (int i = entry.index; i < entry.index + entry.count; ++i) {
+                    if (primHit(primIndices[i]))
+                        return true;
+                }
+                continue;
+            }
+
+            const WideBVHNode& node = nodes[entry.index];
+            float tEnter[WideBVHNode::width];
+            int mask = intersectChildren(node, ray, float(t_min), float(t_max), tEnter);
+            for (int i = 0; i < node.childCount; ++i) {
+                if (mask & (1 << i))
+                    stack[top++] = StackEntry(node.child[i], node.count[i], tEnter[i]);
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @struct PacketData
+     * @brief Single-precision copies of the rays of a packet, plus the interval they span.
+     *
+     * The intervals bound the origins and reciprocal directions of all active rays.
+     * Only an axis along which every ray points the same way, and none runs parallel
+     * to the slabs, takes part in the frustum test.
+     */
+    struct PacketData {
+        RayData rays[RayPacket::size];
+        float originMin[3], originMax[3];
+        float invMin[3], invMax[3];
+        int sign[3]; // 1 or -1 if all rays point up or down the axis, 0 otherwise.
+
+        explicit PacketData(const RayPacket& packet) {
+            bool positive[3] = { true, true, true };
+            bool negative[3] = { true, true, true };
+            for (int axis = 0; axis < 3; ++axis) {
+                originMin[axis] = invMin[axis] = std::numeric_limits<float>::infinity();
+                originMax[axis] = invMax[axis] = -std::numeric_limits<float>::infinity();
+            }
+            for (int lane = 0; lane < RayPacket::size; ++lane) {
+                if (!(packet.activeMask() & (1 << lane))) continue;
+                rays[lane] = RayData(packet.ray(lane));
+                for (int axis = 0; axis < 3; ++axis) {
+                    float inv = rays[lane].invDirection[axis];
+                    originMin[axis] = std::min(originMin[axis], rays[lane].origin[axis]);
+                    originMax[axis] = std::max(originMax[axis], rays[lane].origin[axis]);
+                    invMin[axis] = std::min(invMin[axis], inv);
+                    invMax[axis] = std::max(invMax[axis], inv);
+                    positive[axis] = positive[axis] && inv > 0 && std::isfinite(inv);
+                    negative[axis] = negative[axis] && inv < 0 && std::isfinite(inv);
+                }
+            }
+            for (int axis = 0; axis < 3; ++axis) {
+                sign[axis] = positive[axis] ? 1 : (negative[axis] ? -1 : 0);
+            }
+        }
+    };
+
+    /**
+     * @struct PacketEntry
+     * @brief A pending node or leaf range of a packet traversal, with the rays that reach it.
+     */
+    struct PacketEntry {
+        int index;   // Node index, or first primitive slot of a leaf.
+        int count;   // Number of primitives of a leaf, 0 for a node.
+        int mask;    // Lanes whose rays overlap the entry.
+        float t;     // Smallest entry distance among those rays.
+
+        PacketEntry() {} // Left uninitialized, like StackEntry.
+        PacketEntry(int index, int count, int mask, float t) : index(index), count(count), mask(mask), t(t) {}
+    };
+
+    /**
+     * @brief Gets the largest range end among some lanes of a packet.
+     * @param packet The rays.
+     * @param mask The lanes to look at.
+     * @return The largest tMax of those lanes.
+     */
+    static real maxRange(const RayPacket& packet, int mask) {
+        real result = -std::numeric_limits<real>::infinity();
+        for (int lane = 0; lane < RayPacket::size; ++lane) {
+            if ((mask & (1 << lane)) && packet.tMax[lane] > result) result = packet.tMax[lane];
+        }
+        return result;
+    }
+
+    /**
+     * @brief Tests the frustum spanned by a packet against all children of a node.
+     * Slab distances are bounded with interval arithmetic over the packet's origins
+     * and reciprocal directions, so a child is only rejected if every ray of the
+     * packet would miss it. With the direction sign fixed, the near slab is the
+     * same for every ray and each bound is a single product.
+     * @param bounds The child boxes of the node.
+     * @param childCount The number of children in use.
+     * @param rays The packet in single precision.
+     * @param tMin The smallest range start of the rays.
+     * @param tMax The largest range end of the rays.
+     * @return A bit mask of the children some ray of the packet may overlap.
+     */
+    static int cullChildren(const ChildBounds& bounds, int childCount, const PacketData& rays, float tMin, float tMax) {
+        const float exitScale = 1.0000004f;
+        ChildFloats enter = {};
+        enter += tMin;
+        ChildFloats exit = {};
+        exit += tMax;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (!rays.sign[axis]) continue;
+            ChildFloats invMin = {}, invMax = {};
+            invMin += rays.invMin[axis];
+            invMax += rays.invMax[axis];
+
+            // The smallest near distance and the largest far distance over all rays
+            ChildFloats nearOffset = rays.sign[axis] > 0 ? bounds.lo[axis] - rays.originMax[axis] : bounds.hi[axis] - rays.originMin[axis];
+            ChildFloats farOffset = rays.sign[axis] > 0 ? bounds.hi[axis] - rays.originMin[axis] : bounds.lo[axis] - rays.originMax[axis];
+            ChildFloats zero = {};
+            ChildFloats nearest = nearOffset * (nearOffset >= zero ? invMin : invMax);
+            ChildFloats farthest = farOffset * (farOffset >= zero ? invMax : invMin);
+            enter = nearest > enter ? nearest : enter;
+            exit = farthest < exit ? farthest : exit;
+        }
+        ChildInts overlaps = enter <= exit * exitScale;
+
+        int mask = 0;
+        for (int i = 0; i < childCount; ++i) {
+            if (overlaps[i]) mask |= 1 << i;
+        }
+        return mask;
+    }
+
+    /**
+     * @brief Tests the rays of a packet against all children of a node.
+     * While all rays of the packet are still together, children the packet's
+     * frustum misses are dropped first. Every remaining ray
+     * then runs the single-ray child test, so it visits exactly the children it
+     * would visit on its own.
+     * @param node The node whose children to test.
+     * @param rays The packet in single precision.
+     * @param packet The packet, for its ranges.
+     * @param mask The lanes to test.
+     * @param childMask Receives, per child, the lanes that overlap it.
+     * @param tEnter Receives, per child, the smallest entry distance of those lanes.
+     */
+    static void intersectChildren(const WideBVHNode& node, const PacketData& rays, const RayPacket& packet, int mask,
+                                  int childMask[], float tEnter[]) {
+        for (int i = 0; i < WideBVHNode::width; ++i) {
+            childMask[i] = 0;
+            tEnter[i] = std::numeric_limits<float>::infinity();
+        }
+        // Once the rays have split up, the frustum of the whole packet no longer bounds them tightly
+        ChildBounds bounds(node);
+        float tMin = float(packet.tMin);
+        int candidates = (1 << node.childCount) - 1;
+        if (mask == packet.activeMask()) {
+            candidates = cullChildren(bounds, node.childCount, rays, tMin, float(maxRange(packet, mask)));
+            if (!candidates) return;
+        }
+
+        for (int lanes = mask; lanes; lanes &= lanes - 1) {
+            int lane = __builtin_ctz(lanes);
+            float laneEnter[WideBVHNode::width];
+            int hits = intersectChildren(bounds, node.childCount, rays.rays[lane], tMin, float(packet.tMax[lane]), laneEnter) & candidates;
+            for (; hits; hits &= hits - 1) {
+                int i = __builtin_ctz(hits);
+                childMask[i] |= 1 << lane;
+                tEnter[i] = std::min(tEnter[i], laneEnter[i]);
+            }
+        }
+    }
+
+    static const double rebuildThreshold; // Cost growth over the built tree that makes a rebuild worthwhile.
+
+    int collapse(const BVH& binary, int binaryIndex); // Turns a binary subtree into wide nodes.
+    AABB refitNode(int index, const std::vector<AABB>& primBounds, double& areaCost); // Refits a subtree bottom-up.
+    static void quantize(WideBVHNode& node, const AABB* childBounds); // Stores child boxes relative to the node box.
+
+    std::vector<WideBVHNode> nodes; // Nodes, root at index 0.
+    std::vector<int> primIndices;   // Primitive indices in leaf order.
+    double builtCost = 0;           // SAH cost right after the last build.
+    double cost = 0;                // SAH cost of the current, possibly refitted, tree.
+};
+
+/**
+ * @class BVHAccelerator
+ * @brief Accelerator that walks a wide BVH built over the world's objects.
+ */
+class BVHAccelerator : public Accelerator {
+public:
+    virtual void build(const std::vector<std::shared_ptr<Hittable>>& objects) override; // Builds the BVH.
+    virtual void update(const std::vector<std::shared_ptr<Hittable>>& objects) override; // Refits the BVH, rebuilding it once refits degrade it.
+    virtual bool hit(const Ray& r, real t_min, real t_max, HitRecord& rec) const override; // Closest-hit query.
+    virtual bool occluded(const Ray& r, real t_min, real t_max, const Hittable** blocker = nullptr) const override; // Any-hit query.
+    virtual int hitPacket(RayPacket& packet, HitRecord rec[]) const override; // Closest-hit query for a packet, in one traversal.
+    virtual int occludedPacket(const RayPacket& packet) const override; // Any-hit query for a packet, in one traversal.
+    virtual std::string name() const override { return "bvh"; }
+
+private:
+    PrimitiveArrays prims;                          // Copies of the objects, stored in leaf order.
+    WideBVH bvh;                                    // Hierarchy over the object bounds.
+};
+
+#endif // WIDE_BVH_H
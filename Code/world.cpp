@@ -1,5 +1,113 @@
 #include "world.h"
 #include "Material.h"
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+std::atomic<unsigned> nextSceneId(1); // Source of unique scene ids.
+
+/**
+ * @struct OccluderCache
+ * @brief The object that last blocked each light, kept per render thread.
+ */
+struct OccluderCache {
+    unsigned sceneId = 0;                     ///< Scene the entries belong to.
+    std::vector<const Hittable*> lastBlocker; ///< Last blocking object per light, null if none yet.
+};
+
+thread_local OccluderCache occluderCache; // Each render thread has its own cache.
+
+} // namespace
+
+// Checks if anything blocks the segment between two points.
+/**
+ * Stops at the first blocking object and computes no hit attributes. When a
+ * light index is given, the object that last blocked that light on this thread
+ * is tested first, since neighbouring shading points are usually shadowed by
+ * the same object.
+ * @param origin The start of the segment, e.g. a shading point.
+ * @param target The end of the segment, e.g. a light position.
+ * @param lightIndex The index of the light the segment leads to, or -1 to skip the cache.
+ * @return True if the segment is blocked, false otherwise.
+ */
+bool World::occluded(const vec3& origin, const vec3& target, int lightIndex) const {
+    vec3 toTarget = target - origin;
+    double distance = toTarget.length();
+    if (distance == 0) return false;
+
+    Ray r(origin, toTarget / distance, vec3(0, 0, 0), 0);
+    double t_min = 0.001;
+    double t_max = distance;
+
+    if (lightIndex < 0) {
+        return accelerator->occluded(r, t_min, t_max);
+    }
+
+    if (occluderCache.sceneId != sceneId) {
+        occluderCache.sceneId = sceneId;
+        occluderCache.lastBlocker.assign(lightSources.size(), nullptr);
+    }
+
+    const Hittable*& lastBlocker = occluderCache.lastBlocker[lightIndex];
+    if (lastBlocker && lastBlocker->occludes(r, t_min, t_max)) {
+        return true;
+    }
+
+    const Hittable* blocker = nullptr;
+    if (accelerator->occluded(r, t_min, t_max, &blocker)) {
+        lastBlocker = blocker;
+        return true;
+    }
+    return false;
+}
+
+// Finds the closest hit of a ray, without shading.
+/**
+ * The intersection query of World::hit on its own, for renderers that shade
+ * hits in a separate pass.
+ * @param r The ray to test.
+ * @param rec The record to store hit information.
+ * @return True if the ray hits an object, false otherwise.
+ */
+bool World::closestHit(const Ray& r, HitRecord& rec) const {
+    return accelerator->hit(r, 0.001, std::numeric_limits<double>::infinity(), rec);
+}
+
+// Checks if a ray hits anything, without shading.
+/**
+ * Used for visibility-only passes: a single any-hit query that stops at the
+ * first intersection found, with no lights, materials or secondary rays.
+ * @param r The ray to test.
+ * @return True if the ray hits any object, false otherwise.
+ */
+bool World::anyHit(const Ray& r) const {
+    return accelerator->occluded(r, 0.001, std::numeric_limits<double>::infinity());
+}
+
+// Finds the closest hits of a packet of camera rays, without shading.
+/**
+ * The packet counterpart of the first query of World::hit, with the same
+ * minimum distance; each hit is shaded afterwards with World::shade.
+ * @param packet The rays; the range of every ray that hits is shrunk to the hit.
+ * @param rec Receives the hit record of each lane that hits, indexed by lane.
+ * @return The bit mask of lanes that hit an object.
+ */
+int World::hitPacket(RayPacket& packet, HitRecord rec[]) const {
+    packet.tMin = 0.001;
+    return accelerator->hitPacket(packet, rec);
+}
+
+// Checks which rays of a packet hit anything, without shading.
+/**
+ * @param packet The rays to test, with unbounded ranges.
+ * @return The bit mask of lanes that hit an object.
+ */
+int World::anyHitPacket(RayPacket& packet) const {
+    packet.tMin = 0.001;
+    return accelerator->occludedPacket(packet);
+}
 
 // Computes the reflected ray.
 /**
@@ -7,7 +115,7 @@
  * @param rec The hit record containing intersection details.
  * @return The reflected ray.
  */
-Ray World::compute_reflected_ray(Ray& r, HitRecord& rec) {
+Ray World::compute_reflected_ray(Ray& r, const HitRecord& rec) {
     vec3 reflected_direction = reflect(r.get_normalized(), rec.normal);
     vec3 reflected_origin = rec.p + 0.01 * rec.normal; // Add a small epsilon to avoid self-intersection
     return Ray(reflected_origin, reflected_direction, vec3(0, 0, 0), r.getDepth() + 1);
@@ -20,7 +128,7 @@ Ray World::compute_reflected_ray(Ray& r, HitRecord& rec) {
  * @param normal The normal vector.
  * @return The reflected vector.
  */
-vec3 World::reflect(const vec3& v, const vec3& normal) {
+vec3 World::reflect(const vec3& v, const vec3& normal) const {
     return (v - 2 * vec3::dot(v, normal) * normal).return_unit();
 }
 
@@ -32,80 +140,52 @@ vec3 World::reflect(const vec3& v, const vec3& normal) {
  * @param t_max The maximum t value for a valid hit.
  * @param rec The record to store hit information.
  * @param depth The current recursion depth.
+ * @param sampler The random stream of the pixel sample being traced.
+ * @param sampleDepth The depth whose sample budget to use, or -1 to use depth.
  * @return True if the ray hits an object, false otherwise.
  */
-bool World::hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth) {
+bool World::hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth, Sampler& sampler, int sampleDepth) {
     HitRecord temp_rec;
-    bool hit_anything = false;
-    double closest_so_far = t_max;
-    int numOfNotReachingLights = 0;
 
-    // Check for intersections with all objects in the world
-    for (const auto& object : objects) 
-    {
-        if (object->hit(r, t_min, closest_so_far, temp_rec)) 
-        {
-            hit_anything = true;
-            closest_so_far = temp_rec.t;
-        }
+    // Find the closest intersection through the scene's acceleration structure
+    bool hit_anything = accelerator->hit(r, t_min, t_max, temp_rec);
+
+    // Nothing to shade, and the caller ignores the colour of a missed ray
+    if (!hit_anything) {
+        return false;
     }
-    
+
+    shade(r, t_min, t_max, temp_rec, depth, sampler, sampleDepth);
+    rec = temp_rec;
+    return true;
+}
+
+// Computes the shading of a hit found by an intersection query.
+/**
+ * Lights, reflections and hemisphere samples are traced from the hit point, and
+ * the resulting colour is stored in the ray.
+ * @param r The ray that was hit; receives the shaded colour.
+ * @param t_min The minimum t value for a valid hit of secondary rays.
+ * @param t_max The maximum t value for a valid hit of secondary rays.
+ * @param temp_rec The hit to shade.
+ * @param depth The current recursion depth.
+ * @param sampler The random stream of the pixel sample being traced.
+ * @param sampleDepth The depth whose sample budget to use, or -1 to use depth.
+ */
+void World::shade(Ray& r, double t_min, double t_max, const HitRecord& temp_rec, int depth, Sampler& sampler, int sampleDepth) {
     // Lambertian shading (replace this with your shading model)
-    vec3 diffuse_colour = temp_rec.material.getDiffuseColor();
+    const Material& material = materials[temp_rec.materialId];
+    vec3 diffuse_colour = diffuseColorAt(temp_rec);
     vec3 ambient_part = diffuse_colour;
     // Initialize specular color
     vec3 collected_colour = vec3(0,0,0);
-    vec3 colour_shading = vec3(0,0,0);
-    float kd ; 
-    float ks ;
-    float specularexponent ; 
-
-    vec3 diffuse_part ;
-    vec3 specular_part ; 
-    vec3 light ;
-        
-
-    // Compute shading for each light source
-    for (const auto& lightSource : lightSources)
-    {
-        HitRecord temp_rec_shading;
-        bool hit_anything_shading = false;
-        double closest_so_far_shading = t_max;
-        Ray r_shading(temp_rec.p, lightSource->getPosition(), vec3(0, 0, 0), 0);
-        for (const auto& object : objects) 
-        {   
-            if (object->hit(r_shading, t_min, closest_so_far_shading, temp_rec_shading)) 
-            {
-                hit_anything_shading = true;
-                numOfNotReachingLights += 1;
-            }
-        }
-
-        if (hit_anything_shading) {continue;}
-        
-        vec3 normalLightVector = (lightSource->getPosition() - temp_rec.p).return_unit();
-        vec3 normalViewVector = (camPtr->getPosition() - temp_rec.p).return_unit();
-        vec3 normalReflectedVector = 2*vec3::dot(normalLightVector, temp_rec.normal)*temp_rec.normal - normalLightVector;
-        kd = temp_rec.material.getKd(); 
-        ks = temp_rec.material.getKs();
-        specularexponent = temp_rec.material.getSpecularexponent(); 
-
-
-        double diffuseDot = std::max(0.0, vec3::dot(normalLightVector, temp_rec.normal));
-        double specularDot = std::max(0.0, vec3::dot(normalReflectedVector, normalViewVector));
-        double expoResult = std::pow(specularDot, specularexponent);
-        diffuse_part = kd * diffuseDot * temp_rec.material.getDiffuseColor() * lightSource->getLightColour();
-        specular_part = ks * expoResult * temp_rec.material.getSpecularColor() * lightSource->getLightColour();
-        //light = reflected_ray.getColor();
-        colour_shading += diffuse_part + specular_part;
-    }
-                
+    vec3 colour_shading = phongLights(temp_rec);
 
     HitRecord reflected_rec;
-    int numSamples;
-    if (depth == 0) {numSamples = 15;}
-    else if (depth < 2) {numSamples = 2;}
-    else            {numSamples = 1;}
+    // A mirror bounce spends no samples, so it passes its own budget on to the surface it reaches
+    int budgetDepth = sampleDepth < 0 ? depth : sampleDepth;
+    int numSamples = phongSampleCount(material, budgetDepth);
+    bool deltaLobe = material.getIsreflective() && material.getReflectivity() >= 1.0f;
     
     // Handle reflections recursively
     if (depth < maxBounces) {
@@ -113,17 +193,26 @@ bool World::hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth) {
         for (int i = 0; i < numSamples; ++i) {
             // Sample random direction on the hemispherendom_double
             Ray reflected_ray = compute_reflected_ray(r, temp_rec);
-            vec3 sampledDirection = randomUnitVector(temp_rec.normal);
             reflected_ray.setColor(vec3(0,0,0));
-            if (temp_rec.material.getIsreflective()) {
+            if (deltaLobe) {
                 HitRecord reflected_rec;
-                vec3 updatedDirection = temp_rec.material.getReflectivity()*reflected_ray.getDirection() + (1.0-temp_rec.material.getReflectivity())*sampledDirection;
+                if (hit(reflected_ray, t_min, t_max, reflected_rec, depth + 1, sampler, budgetDepth)) {
+                    double dotPrd = std::max<double>(0.0, vec3::dot(temp_rec.normal, (-1)*reflected_rec.normal));
+                    collected_colour += dotPrd*material.getSpecularColor() * reflected_ray.getColor();
+                }
+                continue;
+            }
+
+            vec3 sampledDirection = randomUnitVector(temp_rec.normal, sampler);
+            if (material.getIsreflective()) {
+                HitRecord reflected_rec;
+                vec3 updatedDirection = material.getReflectivity()*reflected_ray.getDirection() + (1.0-material.getReflectivity())*sampledDirection;
                 reflected_ray.setDirection(updatedDirection);
                 if (depth < maxBounces) {
                     HitRecord reflected_rec;
-                    if (hit(reflected_ray, t_min, t_max, reflected_rec, depth + 1)) {
-                            double dotPrd = std::max(0.0, vec3::dot(temp_rec.normal, (-1)*reflected_rec.normal));
-                            collected_colour +=  (1.0/numSamples)*dotPrd*temp_rec.material.getSpecularColor() * reflected_ray.getColor();
+                    if (hit(reflected_ray, t_min, t_max, reflected_rec, depth + 1, sampler)) {
+                            double dotPrd = std::max<double>(0.0, vec3::dot(temp_rec.normal, (-1)*reflected_rec.normal));
+                            collected_colour +=  (1.0/numSamples)*dotPrd*material.getSpecularColor() * reflected_ray.getColor();
                     }
                 }  
             }
@@ -134,9 +223,9 @@ bool World::hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth) {
                 reflected_ray.setDirection(sampledDirection);
 
                 HitRecord sampledRec;
-                if (hit(reflected_ray, t_min, t_max, sampledRec, depth + 1)) {
-                    double dotPrd = std::max(0.0, vec3::dot(temp_rec.normal, (-1) * sampledRec.normal));
-                    collected_colour += (1.0/numSamples)*dotPrd * temp_rec.material.getSpecularColor() * sampledRec.material.getDiffusecolor();
+                if (hit(reflected_ray, t_min, t_max, sampledRec, depth + 1, sampler)) {
+                    double dotPrd = std::max<double>(0.0, vec3::dot(temp_rec.normal, (-1) * sampledRec.normal));
+                    collected_colour += (1.0/numSamples)*dotPrd * material.getSpecularColor() * diffuseColorAt(sampledRec);
                     
                 }
             }
@@ -149,28 +238,228 @@ bool World::hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth) {
 
     //r.setColor(r.getColor() + ambient_part + collected_colour);
     r.setColor(ambient_part + collected_colour + colour_shading);
-    rec = temp_rec;    
+}
 
-    return hit_anything;
+
+// Sums the Phong light terms at a hit over every light that reaches it.
+/**
+ * @param rec The hit to light.
+ * @return The diffuse and specular light reflected towards the camera, without the ambient term.
+ */
+vec3 World::phongLights(const HitRecord& rec) const {
+    const Material& material = materials[rec.materialId];
+    vec3 diffuse_colour = diffuseColorAt(rec);
+    vec3 colour_shading = vec3(0,0,0);
+    float kd ; 
+    float ks ;
+    float specularexponent ; 
+
+    vec3 diffuse_part ;
+    vec3 specular_part ; 
+
+    // Compute shading for each light source
+    for (size_t lightIndex = 0; lightIndex < lightSources.size(); ++lightIndex)
+    {
+        const auto& lightSource = lightSources[lightIndex];
+        if (occluded(rec.p, lightSource->getPosition(), int(lightIndex)))
+        {
+            continue;
+        }
+        
+        vec3 normalLightVector = (lightSource->getPosition() - rec.p).return_unit();
+        vec3 normalViewVector = (camPtr->getPosition() - rec.p).return_unit();
+        vec3 normalReflectedVector = 2*vec3::dot(normalLightVector, rec.normal)*rec.normal - normalLightVector;
+        kd = material.getKd(); 
+        ks = material.getKs();
+        specularexponent = material.getSpecularexponent(); 
+
+
+        double diffuseDot = std::max<double>(0.0, vec3::dot(normalLightVector, rec.normal));
+        double specularDot = std::max<double>(0.0, vec3::dot(normalReflectedVector, normalViewVector));
+        double expoResult = std::pow(specularDot, specularexponent);
+        diffuse_part = kd * diffuseDot * diffuse_colour * lightSource->getLightColour();
+        specular_part = ks * expoResult * material.getSpecularColor() * lightSource->getLightColour();
+        //light = reflected_ray.getColor();
+        colour_shading += diffuse_part + specular_part;
+    }
+                
+
+
+    return colour_shading;
+}
+
+// Gets how many reflection samples the Phong shader traces from a surface.
+/**
+ * A glossy ray blends the mirror direction m with a random unit vector u as
+ * r * m + (1 - r) * u for reflectivity r, so for r > 0.5 its directions fill a
+ * cone around m of half-angle asin((1 - r) / r). The variance of the averaged
+ * reflection grows with the spread of that cone, so the depth's budget is scaled
+ * by the cone's solid angle as a share of the hemisphere, 1 - cos(half-angle).
+ * For r <= 0.5 the lobe covers the whole hemisphere and keeps the full budget.
+ * @param material The material of the surface.
+ * @param budgetDepth The depth whose sample budget to use.
+ * @return The number of secondary rays; a perfect mirror always gets one.
+ */
+int World::phongSampleCount(const Material& material, int budgetDepth) const {
+    int numSamples;
+    if (budgetDepth == 0) {numSamples = 15;}
+    else if (budgetDepth < 2) {numSamples = 2;}
+    else            {numSamples = 1;}
+
+    // A perfect mirror is a delta lobe: every sample would follow the same direction
+    bool deltaLobe = material.getIsreflective() && material.getReflectivity() >= 1.0f;
+    if (deltaLobe) {
+        numSamples = 1;
+    }
+    else if (material.getIsreflective() && material.getReflectivity() > 0.5f) {
+        double spread = (1.0 - material.getReflectivity()) / material.getReflectivity();
+        double lobeShare = 1.0 - std::sqrt(1.0 - spread * spread);
+        numSamples = std::max(1, int(std::ceil(numSamples * lobeShare)));
+    }
+    return numSamples;
+}
+
+
+// Traces one path from a camera ray and returns the radiance it carries.
+/**
+ * The path is followed iteratively. At every non-mirror vertex the point lights
+ * are sampled directly (next-event estimation) with the same unattenuated light
+ * convention and Phong terms as the recursive shader, then the path continues in
+ * a cosine-weighted diffuse direction, or in the mirror direction with probability
+ * equal to the reflectivity of a reflective material. After a few bounces paths
+ * are ended by Russian roulette, so the cost per sample stays bounded while the
+ * estimate stays unbiased.
+ * @param r The camera ray.
+ * @param sampler The random stream of the pixel sample being traced.
+ * @param radiance Receives the radiance carried back along the path.
+ * @return True if the camera ray hits an object, false otherwise.
+ */
+bool World::tracePath(const Ray& r, Sampler& sampler, vec3& radiance) const {
+    radiance = vec3(0, 0, 0);
+    vec3 throughput(1, 1, 1);
+    Ray ray = r;
+
+    for (int bounce = 0; bounce < maxPathLength; ++bounce) {
+        HitRecord rec;
+        if (!accelerator->hit(ray, 0.001, std::numeric_limits<double>::infinity(), rec)) {
+            return bounce > 0;
+        }
+
+        if (!scatterPath(ray, rec, sampler, throughput, radiance)) break;
+    }
+    return true;
 }
 
+// Lights one vertex of a path and continues the path from it.
+/**
+ * Adds the light sampled directly at the hit to the path's radiance, then picks
+ * the next direction and plays Russian roulette, as one bounce of tracePath.
+ * The diffuse lobe is the Lambertian BRDF albedo / pi in both halves: the direct
+ * term divides by pi, and the cosine-weighted bounce cancels it against the
+ * sampling density cos / pi, leaving a throughput factor of albedo. The Phong
+ * highlight is only added to the direct light; no bounce samples it, so light
+ * from other surfaces reaches the eye through the diffuse and mirror lobes alone.
+ * @param ray The ray that reached the vertex; replaced by the next ray of the path.
+ * @param rec The hit at the vertex.
+ * @param sampler The random stream of the pixel sample being traced.
+ * @param throughput The path throughput, updated for the bounce.
+ * @param radiance The radiance gathered by the path so far.
+ * @return True if the path goes on, false if Russian roulette ended it.
+ */
+bool World::scatterPath(Ray& ray, const HitRecord& rec, Sampler& sampler, vec3& throughput, vec3& radiance) const {
+    const int minBouncesBeforeRoulette = 3;
+
+    const Material& material = materials[rec.materialId];
+    vec3 albedo = material.getKd() * diffuseColorAt(rec);
+    vec3 direction = ray.get_normalized();
+
+    // Shade the side of the surface the ray arrived from
+    vec3 normal = rec.normal;
+    if (vec3::dot(normal, direction) > 0) {
+        normal = -normal;
+    }
+
+    double mirrorWeight = material.getIsreflective() ? material.getReflectivity() : 0.0;
+
+    // Next-event estimation towards every light the surface is not a perfect mirror for
+    if (mirrorWeight < 1.0) {
+        vec3 viewVector = -direction;
+        vec3 direct(0, 0, 0);
+        for (size_t lightIndex = 0; lightIndex < lightSources.size(); ++lightIndex) {
+            vec3 lightPosition = lightSources[lightIndex]->getPosition();
+            vec3 lightVector = (lightPosition - rec.p).return_unit();
+            double cosTheta = vec3::dot(lightVector, normal);
+            if (cosTheta <= 0 || occluded(rec.p, lightPosition, int(lightIndex))) continue;
+
+            vec3 reflectedLight = 2 * cosTheta * normal - lightVector;
+            double specularDot = std::max<double>(0.0, vec3::dot(reflectedLight, viewVector));
+            vec3 lightColour = lightSources[lightIndex]->getLightColour();
+            direct += cosTheta / M_PI * albedo * lightColour
+                    + material.getKs() * std::pow(specularDot, material.getSpecularexponent()) * material.getSpecularColor() * lightColour;
+        }
+        radiance += (1.0 - mirrorWeight) * throughput * direct;
+    }
+
+    // Choose the next direction; the lobe probabilities cancel the lobe weights
+    vec3 nextDirection;
+    if (mirrorWeight > 0 && sampler.next1D() < mirrorWeight) {
+        nextDirection = reflect(direction, normal);
+        throughput = throughput * material.getSpecularColor();
+    } else {
+        nextDirection = cosineWeightedDirection(normal, sampler);
+        throughput = throughput * albedo;
+    }
+
+    // Russian roulette on the path throughput
+    if (ray.getDepth() >= minBouncesBeforeRoulette) {
+        double survival = std::min<double>(0.95, std::max(throughput.x, std::max(throughput.y, throughput.z)));
+        if (survival <= 0 || sampler.next1D() >= survival) return false;
+        throughput /= survival;
+    }
+
+    ray = Ray(rec.p + 0.001 * normal, nextDirection, vec3(0, 0, 0), ray.getDepth() + 1);
+    return true;
+}
 
-double random_doubleW(double min, double max) {
-    static std::uniform_real_distribution<double> distribution(min, max);
-    static std::mt19937 generator;  // Mersenne Twister PRNG
-    return distribution(generator);
+// Gets the maximum number of ray bounces.
+/**
+ * @return The bounce limit of the Phong shader, from the scene's "nbounces".
+ */
+int World::getMaxBounces() const {
+    return maxBounces;
 }
 
+// Samples a direction around a normal with a cosine-weighted density.
+/**
+ * @param normal The unit surface normal.
+ * @param sampler The random stream to draw from.
+ * @return A unit direction in the hemisphere of the normal, with density cos(theta) / pi.
+ */
+vec3 World::cosineWeightedDirection(const vec3& normal, Sampler& sampler) const {
+    double r1 = sampler.next1D();
+    double r2 = sampler.next1D();
+    double phi = 2 * M_PI * r1;
+    double sinTheta = std::sqrt(r2);
+    double cosTheta = std::sqrt(1 - r2);
+
+    // Orthonormal basis around the normal
+    vec3 helper = std::abs(normal.x) > 0.9 ? vec3(0, 1, 0) : vec3(1, 0, 0);
+    vec3 tangent = vec3::cross(helper, normal).return_unit();
+    vec3 bitangent = vec3::cross(normal, tangent);
+
+    return (sinTheta * std::cos(phi) * tangent + sinTheta * std::sin(phi) * bitangent + cosTheta * normal).return_unit();
+}
 
 // Generates a random unit vector around a normal.
 /**
  * @param normal The normal vector.
+ * @param sampler The random stream to draw from.
  * @return A random unit vector.
  */
-vec3 World::randomUnitVector(const vec3& normal) {
-    double x=  random_doubleW(0.0, 1.0);
-    double y = random_doubleW(0.0, 1.0);
-    double z = random_doubleW(0.0, 1.0);
+vec3 World::randomUnitVector(const vec3& normal, Sampler& sampler) {
+    double x = sampler.uniform(0.0, 1.0);
+    double y = sampler.uniform(0.0, 1.0);
+    double z = sampler.uniform(0.0, 1.0);
 
     // Generate a random vector in the XY plane
     vec3 randomVec(x, y, z);
@@ -208,36 +497,89 @@ void World::createAndLight(const nlohmann::json& jsonInput){
     //World::addHittable(std::make_shared<Sphere>(newSphere));
 }
 
-// Creates and adds a sphere to the world from JSON input.
+// Finds or adds the material of a shape in the material table.
 /**
- * @param jsonInput The JSON object containing sphere data.
+ * Shapes whose material JSON and texture file are identical share one entry,
+ * so each distinct material is built, and its texture loaded, only once per scene.
+ * @param jsonInput The JSON object of the shape.
  * @param pathToTextures The path to the texture files.
+ * @return The index of the material in the material table.
  */
-void World::createAndAddSphere(const nlohmann::json& jsonInput, const std::string& pathToTextures){    
+int World::addMaterial(const nlohmann::json& jsonInput, const std::string& pathToTextures) {
     #ifdef _WIN32
     std::string os_sep = "\\";
     #else
     std::string os_sep = "/";
     #endif
 
-    vec3 position = vec3(jsonInput["center"][0],
-                         jsonInput["center"][1],
-                         jsonInput["center"][2]);
-    double radius = jsonInput["radius"];
+    std::string materialKey = jsonInput.contains("material") ? jsonInput["material"].dump() : "";
+    std::string texturePath = "";
+    if (jsonInput.contains("texture"))
+    {
+        std::string ppmString = jsonInput["texture"];
+        texturePath = pathToTextures + os_sep + ppmString;
+    }
+    std::string key = texturePath.empty() ? materialKey : materialKey + "|" + texturePath;
 
-    Sphere newSphere(position, radius);
+    std::map<std::string, int>::const_iterator found = materialIndex.find(key);
+    if (found != materialIndex.end())
+    {
+        return found->second;
+    }
+
+    Material material;
     if (jsonInput.contains("material"))
     {
-        newSphere.setMaterial(Material::getMaterialFromJson(jsonInput["material"]));
+        material = Material::getMaterialFromJson(jsonInput["material"]);
     }
-    if (jsonInput.contains("texture"))
+    if (!texturePath.empty())
     {
         std::cout << "setting texture" << std::endl;
-        std::string loc = pathToTextures +os_sep;
-        std::string ppmString = jsonInput["texture"];
-        newSphere.setTexture(loc + ppmString);
+        material.setTexture(texturePath);
     }
 
+    int materialId = int(materials.size());
+    materials.push_back(material);
+    materialIndex[key] = materialId;
+    return materialId;
+}
+
+// Gets a material from the material table.
+/**
+ * @param materialId The index of the material.
+ * @return The material.
+ */
+const Material& World::getMaterial(int materialId) const {
+    return materials[materialId];
+}
+
+// Gets the diffuse color at a hit, taking the texture lookup into account.
+/**
+ * @param rec The hit record.
+ * @return The textured diffuse color if the object is textured, otherwise the material's diffuse color.
+ */
+vec3 World::diffuseColorAt(const HitRecord& rec) const {
+    if (rec.textured) {
+        return rec.textureColor;
+    }
+    return materials[rec.materialId].getDiffuseColor();
+}
+
+// Creates and adds a sphere to the world from JSON input.
+/**
+ * @param jsonInput The JSON object containing sphere data.
+ * @param pathToTextures The path to the texture files.
+ */
+void World::createAndAddSphere(const nlohmann::json& jsonInput, const std::string& pathToTextures){    
+    vec3 position = vec3(jsonInput["center"][0],
+                         jsonInput["center"][1],
+                         jsonInput["center"][2]);
+    double radius = jsonInput["radius"];
+
+    Sphere newSphere(position, radius);
+    int materialId = addMaterial(jsonInput, pathToTextures);
+    newSphere.setMaterial(materialId, materials[materialId]);
+
     World::addHittable(std::make_shared<Sphere>(newSphere));
 }
 
@@ -248,12 +590,6 @@ void World::createAndAddSphere(const nlohmann::json& jsonInput, const std::strin
  */
 void World::createAndAddTriangle(const nlohmann::json& jsonInput, const std::string& pathToTextures)//vec3 vertex1, vec3 vertex2, vec3 vertex3)
 {
-    #ifdef _WIN32
-    std::string os_sep = "\\";
-    #else
-    std::string os_sep = "/";
-    #endif
-
     vec3 vertex1 = vec3(jsonInput["v0"][0],
                         jsonInput["v0"][1],
                         jsonInput["v0"][2]);
@@ -270,17 +606,8 @@ void World::createAndAddTriangle(const nlohmann::json& jsonInput, const std::str
                          vertex2,
                          vertex3);
 
-    if (jsonInput.contains("material"))
-    {
-        newTriangle.setMaterial(Material::getMaterialFromJson(jsonInput["material"]));
-    }
-    if (jsonInput.contains("texture"))
-    {
-        std::cout << "setting texture" << std::endl;
-        std::string loc = pathToTextures +os_sep;
-        std::string ppmString = jsonInput["texture"];
-        newTriangle.setTexture(loc + ppmString);
-    }
+    int materialId = addMaterial(jsonInput, pathToTextures);
+    newTriangle.setMaterial(materialId, materials[materialId]);
                          
     World::addHittable(std::make_shared<Triangle>(newTriangle));
 }
@@ -298,6 +625,39 @@ void World::createAndAddTriangle(vec3 vertex1, vec3 vertex2, vec3 vertex3)
     World::addHittable(std::make_shared<Triangle>(newTriangle));
 }
 
+// Creates and adds an indexed triangle mesh to the world from JSON input.
+/**
+ * The mesh lists its vertices once under "vertices" and its triangles as index
+ * triples under "triangles". Optional "uvs" give per-vertex texture coordinates;
+ * without them the vertex x and y are used, as for single triangles.
+ * @param jsonInput The JSON object containing mesh data.
+ * @param pathToTextures The path to the texture files.
+ */
+void World::createAndAddMesh(const nlohmann::json& jsonInput, const std::string& pathToTextures)
+{
+    std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+
+    const nlohmann::json& vertices = jsonInput["vertices"];
+    bool hasUVs = jsonInput.contains("uvs") && jsonInput["uvs"].size() == vertices.size();
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vec3 position = vec3(vertices[i][0], vertices[i][1], vertices[i][2]);
+        if (hasUVs) {
+            mesh->addVertex(position, jsonInput["uvs"][i][0], jsonInput["uvs"][i][1]);
+        } else {
+            mesh->addVertex(position);
+        }
+    }
+
+    for (const auto& triangle : jsonInput["triangles"]) {
+        mesh->addTriangle(triangle[0], triangle[1], triangle[2]);
+    }
+
+    int materialId = addMaterial(jsonInput, pathToTextures);
+    mesh->setMaterial(materialId, materials[materialId]);
+
+    World::addHittable(mesh);
+}
+
 // Creates and adds a cylinder to the world from JSON input.
 /**
  * @param jsonInput The JSON object containing cylinder data.
@@ -305,12 +665,6 @@ void World::createAndAddTriangle(vec3 vertex1, vec3 vertex2, vec3 vertex3)
  */
 void World::createAndAddCylinder(const nlohmann::json& jsonInput, const std::string& pathToTextures)//vec3 bottomCenter, double radius, double height, vec3 normalVector)
 {
-    #ifdef _WIN32
-    std::string os_sep = "\\";
-    #else
-    std::string os_sep = "/";
-    #endif
-
     double height = jsonInput["height"];
     double radius = jsonInput["radius"];    
 
@@ -324,36 +678,16 @@ void World::createAndAddCylinder(const nlohmann::json& jsonInput, const std::str
 
     vec3 bottomCenter = cylinderCenter - normalVector*(0.5*height);
 
-
-    vec3 upperCenter = bottomCenter + normalVector*(height);
-    Circle topCircle (upperCenter, radius, normalVector, height);
-    Circle bottomCircle(bottomCenter, radius, normalVector*(-1), height);
-
+    // One closed cylinder covers the tube and both caps
     Cylinder cylinder(bottomCenter, //center of the bottom circle 
                       radius,             //radious
                       height,            //height
                       normalVector);
 
-
-    if (jsonInput.contains("material"))
-    {
-        cylinder.setMaterial(Material::getMaterialFromJson(jsonInput["material"]));
-        topCircle.setMaterial(Material::getMaterialFromJson(jsonInput["material"]));
-        bottomCircle.setMaterial(Material::getMaterialFromJson(jsonInput["material"]));
-    }
-    if (jsonInput.contains("texture"))
-    {
-        std::cout << "setting texture" << std::endl;
-        std::string loc = pathToTextures +os_sep;
-        std::string ppmString =jsonInput["texture"];
-        cylinder.setTexture(loc + ppmString);
-        topCircle.setTexture(loc + ppmString);
-        bottomCircle.setTexture(loc + ppmString);
-    }
+    int materialId = addMaterial(jsonInput, pathToTextures);
+    cylinder.setMaterial(materialId, materials[materialId]);
 
     World::addHittable(std::make_shared<Cylinder>(cylinder));
-    World::addHittable(std::make_shared<Circle>(topCircle));
-    World::addHittable(std::make_shared<Circle>(bottomCircle));
 }
 
 // Creates and adds a floor to the world.
@@ -373,6 +707,208 @@ void World::createAndAddFloor(vec3 floorCenter, double floorSize){
 }
 
 
+// Creates and adds an instance of a named geometry group from JSON input.
+/**
+ * The optional "transform" is a row-major 4x4 matrix, given either as four rows
+ * or as sixteen numbers; without it the group is placed as defined.
+ * @param jsonInput The JSON object containing instance data.
+ */
+void World::createAndAddInstance(const nlohmann::json& jsonInput)
+{
+    std::string name = jsonInput["geometry"];
+    auto group = geometries.find(name);
+    if (group == geometries.end()) {
+        std::cerr << "Unknown geometry \"" << name << "\", skipping instance." << std::endl;
+        return;
+    }
+    if (group->second->getNesting() > HitInfo::maxNesting) {
+        std::cerr << "Geometry \"" << name << "\" nests more than " << HitInfo::maxNesting
+                  << " groups deep, skipping instance." << std::endl;
+        return;
+    }
+
+    Matrix4 transform;
+    if (jsonInput.contains("transform")) {
+        const nlohmann::json& t = jsonInput["transform"];
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                transform.m[i][j] = t.size() == 16 ? double(t[4 * i + j]) : double(t[i][j]);
+            }
+        }
+    }
+
+    World::addHittable(std::make_shared<Instance>(group->second, transform));
+}
+
+// Adds every shape of a JSON shape list to the world.
+/**
+ * @param shapesInfo The JSON array of shapes.
+ * @param pathToTextures The path to the texture files.
+ */
+void World::loadShapes(const nlohmann::json& shapesInfo, const std::string& pathToTextures)
+{
+    for (const auto& shapeInfo : shapesInfo) {
+        std::string type = shapeInfo["type"];
+        if (type == "sphere") {
+            createAndAddSphere(shapeInfo, pathToTextures);
+        } else if (type == "cylinder") {
+            createAndAddCylinder(shapeInfo, pathToTextures);
+        } else if (type == "triangle") {
+            createAndAddTriangle(shapeInfo, pathToTextures);
+        } else if (type == "mesh") {
+            createAndAddMesh(shapeInfo, pathToTextures);
+        } else if (type == "instance") {
+            createAndAddInstance(shapeInfo);
+        }
+        // More shape types can be added here once implemented
+    }
+}
+
+// Builds the named geometry groups that instances refer to.
+/**
+ * Each entry maps a name to a shape list in the group's own object space. The
+ * group is baked once here; instances only share it. A group may instance the
+ * groups listed before it.
+ * @param geometriesInfo The JSON object mapping names to shape lists.
+ * @param pathToTextures The path to the texture files.
+ */
+void World::loadGeometries(const nlohmann::json& geometriesInfo, const std::string& pathToTextures)
+{
+    for (auto entry = geometriesInfo.begin(); entry != geometriesInfo.end(); ++entry) {
+        // Load the group's shapes through the usual path, into a scratch object list
+        std::vector<std::shared_ptr<Hittable>> sceneObjects, sceneShapes, sceneOwners;
+        objects.swap(sceneObjects);
+        shapes.swap(sceneShapes);
+        shapeOwners.swap(sceneOwners);
+        loadShapes(entry.value(), pathToTextures);
+
+        std::shared_ptr<GeometryGroup> group = std::make_shared<GeometryGroup>();
+        for (const auto& object : objects) {
+            group->add(object);
+        }
+        objects.swap(sceneObjects);
+        shapes.swap(sceneShapes);
+        shapeOwners.swap(sceneOwners);
+
+        group->bake();
+        geometries[entry.key()] = group;
+    }
+}
+
+// Replaces the loaded spheres by SIMD sphere clusters.
+/**
+ * Spheres spanning more than half the extent of all spheres along some axis, such
+ * as a ground sphere, would stretch every cluster they joined, so they stay single
+ * objects. Scenes with fewer spheres than one cluster holds are left alone.
+ */
+void World::packSpheres() {
+    std::vector<std::shared_ptr<Sphere>> spheres;
+    std::vector<std::shared_ptr<Hittable>> others;
+    AABB sphereBounds;
+    for (const auto& object : objects) {
+        std::shared_ptr<Sphere> sphere = std::dynamic_pointer_cast<Sphere>(object);
+        if (sphere) {
+            spheres.push_back(sphere);
+            sphereBounds.expand(sphere->bounds());
+        } else {
+            others.push_back(object);
+        }
+    }
+    if (spheres.size() < size_t(SphereCluster::maxSize)) return;
+
+    vec3 extent = sphereBounds.max - sphereBounds.min;
+    std::vector<std::shared_ptr<Sphere>> small;
+    for (const auto& sphere : spheres) {
+        AABB box = sphere->bounds();
+        vec3 size = box.max - box.min;
+        if (size.x > 0.5 * extent.x || size.y > 0.5 * extent.y || size.z > 0.5 * extent.z) {
+            others.push_back(sphere);
+        } else {
+            small.push_back(sphere);
+        }
+    }
+
+    // Each clustered sphere keeps its object index, so record which cluster now holds it
+    std::map<const Hittable*, std::shared_ptr<Hittable>> clusterOf;
+    for (const auto& cluster : SphereCluster::cluster(small)) {
+        others.push_back(cluster);
+        for (const auto& sphere : cluster->getSpheres()) {
+            clusterOf[sphere.get()] = cluster;
+        }
+    }
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        auto owner = clusterOf.find(shapes[i].get());
+        if (owner != clusterOf.end()) shapeOwners[i] = owner->second;
+    }
+    objects.swap(others);
+}
+
+// Rebuilds the top-level acceleration structure over the world's objects.
+/**
+ * Call after adding or removing objects; for objects that only moved,
+ * updateAccelerator is cheaper. Shapes and geometry groups keep their baked data,
+ * so only the structure over the object boxes is rebuilt.
+ */
+void World::rebuildAccelerator() {
+    accelerator = Accelerator::create(acceleratorType);
+    accelerator->build(objects);
+
+    // Cached blockers point into the accelerator's primitive copies
+    sceneId = nextSceneId++;
+}
+
+// Refits the top-level structure after objects moved.
+/**
+ * Meant to be called once per frame after any number of transformObject calls.
+ * The BVH keeps its topology and only recomputes node boxes, falling back to a
+ * rebuild once the refitted tree gets too expensive to traverse; the other
+ * accelerators rebuild.
+ */
+void World::updateAccelerator() {
+    if (!accelerator) {
+        rebuildAccelerator();
+        return;
+    }
+    accelerator->update(objects);
+
+    // Cached blockers point into the accelerator's primitive copies
+    sceneId = nextSceneId++;
+}
+
+// Gets the number of shapes.
+/**
+ * @return The number of shapes added to the world, which can be more than the
+ *         number of top-level objects once spheres are packed into clusters.
+ */
+int World::getObjectCount() const {
+    return int(shapes.size());
+}
+
+// Gets a shape by index.
+/**
+ * Shapes keep the order they were added in, scene file order for a loaded
+ * scene. A sphere packed into a cluster is still returned on its own.
+ * @param index The index of the shape.
+ * @return The shape.
+ */
+std::shared_ptr<Hittable> World::getObject(int index) const {
+    return shapes.at(index);
+}
+
+// Moves one shape.
+/**
+ * A sphere packed into a cluster is moved alone and the cluster is baked again,
+ * so the other spheres of the cluster stay where they are.
+ * @param index The index of the shape, as for getObject.
+ * @param transform The transform to apply on top of the current placement.
+ */
+void World::transformObject(int index, const Matrix4& transform) {
+    shapes.at(index)->transform(transform);
+    if (shapeOwners[index] != shapes[index]) {
+        shapeOwners[index]->bake();
+    }
+}
+
 // Clears the objects and light sources in the world and loads a new scene.
 /**
  * @param filename The file path to the scene JSON file.
@@ -385,9 +921,18 @@ void World::loadScene(const std::string& filename, Camera& camera, const std::st
     nlohmann::json sceneJson;
     file >> sceneJson;
 
-    // Clear existing objects and light sources
+    // Clear existing objects, light sources and materials
     objects.clear();
+    shapes.clear();
+    shapeOwners.clear();
     lightSources.clear();
+    materials.clear();
+    materialIndex.clear();
+    geometries.clear();
+
+    // Shapes without a material use the default one at index 0
+    materials.push_back(Material());
+    materialIndex[""] = 0;
     
     // Set the maximum number of bounces for reflections
     if (sceneJson.contains("nbounces"))
@@ -399,6 +944,13 @@ void World::loadScene(const std::string& filename, Camera& camera, const std::st
     }
 
     std::cout << maxBounces <<std::endl;
+
+    // Select the acceleration structure; "linear" restores the plain object loop
+    acceleratorType = "bvh";
+    if (sceneJson.contains("accelerator"))
+    {
+        acceleratorType = sceneJson["accelerator"];
+    }
     
     // Extract world information
     const nlohmann::json& sceneInfo = sceneJson["scene"];
@@ -412,20 +964,32 @@ void World::loadScene(const std::string& filename, Camera& camera, const std::st
     camera.setupFromJson(sceneJson["camera"], sceneJson["rendermode"], background);
     camPtr = &camera;
     
+    // Named geometry groups come first so that shapes can instance them
+    if (sceneInfo.contains("geometries")) {
+        loadGeometries(sceneInfo["geometries"], pathToTextures);
+    }
+
     // Extract shapes information and add them to the world
-    const nlohmann::json& shapesInfo = sceneInfo["shapes"];
-    for (const auto& shapeInfo : shapesInfo) {
-        std::string type = shapeInfo["type"];
-        if (type == "sphere") {
-            createAndAddSphere(shapeInfo, pathToTextures);
-        } else if (type == "cylinder") {
-            createAndAddCylinder(shapeInfo, pathToTextures);
-        } else if (type == "triangle") {
-            createAndAddTriangle(shapeInfo, pathToTextures);
-        }
-        // More shape types can be added here once implemented
+    loadShapes(sceneInfo["shapes"], pathToTextures);
+
+    // Precompute per-primitive intersection data and bounds before anything is built over them
+    for (const auto& object : objects) {
+        object->bake();
     }
 
+    // Spheres are tested in SIMD batches rather than one virtual call each
+    packSpheres();
+
+    // Per-thread caches keyed on the old scene are stale now
+    sceneId = nextSceneId++;
+
+    // Build the acceleration structure over all loaded shapes
+    rebuildAccelerator();
+    std::cout << "Accelerator: " << accelerator->name() << " over " << objects.size() << " objects" << std::endl;
+
+    // The old accelerator held the previous scene's shapes; with it gone, textures only they used can go
+    Texture::releaseUnused();
+
     // Extract light sources and add them to the world
     if (sceneInfo.contains("lightsources")) {
         const nlohmann::json& lightsInfo = sceneInfo["lightsources"];
@@ -4,8 +4,8 @@
 #include <vector>
 #include <iostream>
 #include <string>
-#include <random>
 #include <memory>
+#include <map>
 #include "json-develop/single_include/nlohmann/json.hpp"
 
 #include "hittable.h"
@@ -13,8 +13,13 @@
 #include "triangle.h"
 #include "circle.h"
 #include "cylinder.h"
+#include "mesh.h"
+#include "instance.h"
+#include "sphere_cluster.h"
+#include "accelerator.h"
 #include "Camera.h"
 #include "vector.h"
+#include "sampler.h"
 
 class Camera;
 
@@ -24,10 +29,12 @@ class Camera;
  */
 class World {
 public:
-    World() {} // Default constructor.
+    World() : sceneId(0) {} // Default constructor.
 
     void addHittable(std::shared_ptr<Hittable> hittable) {
         objects.push_back(hittable);
+        shapes.push_back(hittable);
+        shapeOwners.push_back(hittable);
     }
 // Adds a hittable object to the world.
 void addLightSource(std::shared_ptr<Sphere> hittable) {
@@ -40,21 +47,60 @@ void addLightSource(std::shared_ptr<Sphere> hittable) {
     void createAndAddTriangle(vec3 vertex1, vec3 vertex2, vec3 vertex3); // Adds a triangle from vertices.
     void createAndAddSphere(const nlohmann::json& jsonInput, const std::string& pathToTextures); // Adds a sphere from JSON input.
     void createAndAddCylinder(const nlohmann::json& jsonInput, const std::string& pathToTextures); // Adds a cylinder from JSON input.
+    void createAndAddMesh(const nlohmann::json& jsonInput, const std::string& pathToTextures); // Adds an indexed triangle mesh from JSON input.
+    void createAndAddInstance(const nlohmann::json& jsonInput); // Adds an instance of a named geometry group from JSON input.
+    void loadShapes(const nlohmann::json& shapesInfo, const std::string& pathToTextures); // Adds every shape of a JSON shape list.
+    void loadGeometries(const nlohmann::json& geometriesInfo, const std::string& pathToTextures); // Builds the named geometry groups.
+    void packSpheres(); // Replaces the loaded spheres by SIMD sphere clusters.
+    void rebuildAccelerator(); // Rebuilds the top-level structure from scratch.
+    void updateAccelerator(); // Refits the top-level structure after objects moved.
+    // Object indices count the shapes in the order they were added, one per scene file shape.
+    // They stay valid after spheres are packed into clusters: a sphere keeps its own index.
+    int getObjectCount() const; // Gets the number of shapes.
+    std::shared_ptr<Hittable> getObject(int index) const; // Gets a shape by index.
+    void transformObject(int index, const Matrix4& transform); // Moves one shape; call updateAccelerator afterwards.
     void createAndAddFloor(vec3 floorCenter, double floorSize); // Adds a floor to the world.
     void loadScene(const std::string& filename, Camera& camera, const std::string& pathToTextures); // Loads a scene from a file.
+    int addMaterial(const nlohmann::json& jsonInput, const std::string& pathToTextures); // Finds or adds a shape's material in the material table.
+    const Material& getMaterial(int materialId) const; // Gets a material from the material table.
+    vec3 diffuseColorAt(const HitRecord& rec) const; // Gets the (possibly textured) diffuse color at a hit.
 
-    bool hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth); // Checks for ray-object intersections.
+    bool hit(Ray& r, double t_min, double t_max, HitRecord& rec, int depth, Sampler& sampler, int sampleDepth = -1); // Checks for ray-object intersections.
 
-    Ray compute_reflected_ray(Ray& r, HitRecord& rec); // Computes the reflected ray.
+    void shade(Ray& r, double t_min, double t_max, const HitRecord& temp_rec, int depth, Sampler& sampler, int sampleDepth = -1); // Shades a hit and stores the colour in the ray.
+    vec3 phongLights(const HitRecord& rec) const; // Sums the Phong light terms of the lights that reach a hit.
+    int phongSampleCount(const Material& material, int budgetDepth) const; // Gets how many reflection samples the Phong shader traces from a surface.
+    int hitPacket(RayPacket& packet, HitRecord rec[]) const; // Finds the closest hits of a packet of camera rays, without shading.
 
-    vec3 reflect(const vec3& v, const vec3& normal); // Reflects a vector around a normal.
-    vec3 randomUnitVector(const vec3& normal); // Generates a random unit vector around a normal.
+    bool closestHit(const Ray& r, HitRecord& rec) const; // Finds the closest hit of a ray, without shading.
+    bool anyHit(const Ray& r) const; // Checks if a ray hits anything, without shading.
+    int anyHitPacket(RayPacket& packet) const; // Checks which rays of a packet hit anything, without shading.
+    bool occluded(const vec3& origin, const vec3& target, int lightIndex = -1) const; // Checks if anything blocks the segment between two points.
+    bool tracePath(const Ray& r, Sampler& sampler, vec3& radiance) const; // Traces one path and returns the radiance it carries.
+    bool scatterPath(Ray& ray, const HitRecord& rec, Sampler& sampler, vec3& throughput, vec3& radiance) const; // Lights one path vertex and continues the path from it.
+    int getMaxBounces() const; // Gets the maximum number of ray bounces.
+
+    static const int maxPathLength = 64; // Longest path tracePath follows.
+    vec3 cosineWeightedDirection(const vec3& normal, Sampler& sampler) const; // Samples a direction around a normal with a cosine-weighted density.
+
+    Ray compute_reflected_ray(Ray& r, const HitRecord& rec); // Computes the reflected ray.
+
+    vec3 reflect(const vec3& v, const vec3& normal) const; // Reflects a vector around a normal.
+    vec3 randomUnitVector(const vec3& normal, Sampler& sampler); // Generates a random unit vector around a normal.
 
 private:
     std::vector<std::shared_ptr<Hittable>> objects; // List of objects in the world.
+    std::vector<std::shared_ptr<Hittable>> shapes; // Every shape as added, indexed by object index.
+    std::vector<std::shared_ptr<Hittable>> shapeOwners; // Top-level object holding each shape: the shape itself or its sphere cluster.
     std::vector<std::shared_ptr<Sphere>> lightSources; // List of light sources in the world.
+    std::vector<Material> materials; // Scene material table, index 0 is the default material.
+    std::map<std::string, int> materialIndex; // Material table index by material JSON and texture path.
+    std::map<std::string, std::shared_ptr<GeometryGroup>> geometries; // Named geometry groups shared by instances.
+    std::shared_ptr<Accelerator> accelerator; // Structure answering ray queries against the objects.
+    std::string acceleratorType; // Kind of top-level structure the scene asked for.
     Camera *camPtr; // Pointer to the camera.
     int maxBounces; // Maximum number of ray bounces.
+    unsigned sceneId; // Unique id of the loaded scene, used to invalidate per-thread caches.
 };
 
 #endif // WORLD_H
\ No newline at end of file